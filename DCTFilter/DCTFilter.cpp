@@ -23,260 +23,2148 @@
 */
 
 #include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <set>
 #include <string>
 #include <thread>
+#include <tuple>
 #include <type_traits>
-#include <unordered_map>
+#include <vector>
 
-#include <VapourSynth.h>
-#include <VSHelper.h>
+#ifdef DCTFILTER_X86
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#elif defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#endif
 
-#include <fftw3.h>
+#ifdef __linux__
+#include <sched.h>
+#endif
 
-struct DCTFilterData {
-    VSNodeRef * node;
-    const VSVideoInfo * vi;
-    bool process[3];
-    int peak;
-    float factors[64];
-    fftwf_plan dct, idct;
-    std::unordered_map<std::thread::id, float *> buffer;
+#include "DCTFilter.h"
+#include "ThreadPool.h"
+
+#ifdef DCTFILTER_X86
+// Returns 4 for AVX-512 (F/VL/BW/DQ), 3 for AVX2 with FMA, 2 for SSE2, otherwise 0.
+static int getInstructionSet() noexcept {
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 0);
+    const int maxLeaf = info[0];
+
+    __cpuid(info, 1);
+    if (!(info[3] & (1 << 26)))
+        return 0;
+
+    const bool fma = info[2] & (1 << 12);
+    if (!(info[2] & (1 << 27)) || !(info[2] & (1 << 28)) || maxLeaf < 7)
+        return 2;
+
+    const unsigned long long xcr0 = _xgetbv(0);
+    if ((xcr0 & 0x6) != 0x6)
+        return 2;
+
+    __cpuidex(info, 7, 0);
+    if (!fma || !(info[1] & (1 << 5)))
+        return 2;
+
+    const int avx512 = (1 << 16) | (1 << 17) | (1 << 30) | (1 << 31);
+    if ((xcr0 & 0xE6) != 0xE6 || (info[1] & avx512) != avx512)
+        return 3;
+
+    return 4;
+#else
+    __builtin_cpu_init();
+
+    if (!__builtin_cpu_supports("sse2"))
+        return 0;
+
+    if (!__builtin_cpu_supports("avx2") || !__builtin_cpu_supports("fma"))
+        return 2;
+
+    if (!__builtin_cpu_supports("avx512f") || !__builtin_cpu_supports("avx512vl") || !__builtin_cpu_supports("avx512bw") || !__builtin_cpu_supports("avx512dq"))
+        return 3;
+
+    return 4;
+#endif
+}
+
+static void cpuid(int * info, const int leaf, const int subleaf) noexcept {
+#ifdef _MSC_VER
+    __cpuidex(info, leaf, subleaf);
+#else
+    __cpuid_count(leaf, subleaf, info[0], info[1], info[2], info[3]);
+#endif
+}
+
+static bool hasF16C() noexcept {
+    int info[4];
+    cpuid(info, 1, 0);
+    return info[2] & (1 << 29);
+}
+#endif
+
+// Returns the size of the L1 data cache in bytes, or 0 when it cannot be detected. Intel describes its caches in leaf 4, AMD in leaf
+// 0x80000005.
+static unsigned getDataCacheSize() noexcept {
+#ifdef DCTFILTER_X86
+    int info[4];
+    cpuid(info, 0, 0);
+
+    if (info[0] >= 4) {
+        for (int i = 0;; i++) {
+            cpuid(info, 4, i);
+
+            const int type = info[0] & 0x1F;
+            if (!type)
+                break;
+
+            if ((type == 1 || type == 3) && ((info[0] >> 5) & 0x7) == 1)
+                return ((static_cast<unsigned>(info[1]) >> 22) + 1) * (((info[1] >> 12) & 0x3FF) + 1) * ((info[1] & 0xFFF) + 1) * (info[2] + 1);
+        }
+    }
+
+    cpuid(info, 0x80000000, 0);
+    if (static_cast<unsigned>(info[0]) >= 0x80000005) {
+        cpuid(info, 0x80000005, 0);
+        return (static_cast<unsigned>(info[2]) >> 24) * 1024;
+    }
+
+    return 0;
+#elif defined(_SC_LEVEL1_DCACHE_SIZE)
+    const long size = sysconf(_SC_LEVEL1_DCACHE_SIZE);
+    return size > 0 ? static_cast<unsigned>(size) : 0;
+#else
+    return 0;
+#endif
+}
+
+// The CPUs of every NUMA node holding any, and the node of every CPU. Both stay empty on hosts with a single node, where nothing is done per
+// node. Only Linux exposes the topology this way; elsewhere every host is treated as a single node.
+struct NumaTopology {
+    std::vector<std::vector<int>> cpus;
+    std::vector<unsigned> nodeOf;
+};
+
+static const NumaTopology & getNumaTopology() {
+    static const NumaTopology topology = [] {
+        NumaTopology t;
+#ifdef __linux__
+        // Node numbers need not be contiguous. A cpulist reads like "0-7,16-23".
+        for (int node = 0; node < 1024; node++) {
+            std::ifstream file{ "/sys/devices/system/node/node" + std::to_string(node) + "/cpulist" };
+            std::vector<int> cpus;
+            int first, last;
+            char separator;
+
+            while (file >> first) {
+                last = first;
+                if (file.peek() == '-')
+                    file >> separator >> last;
+
+                for (int cpu = first; cpu <= last; cpu++)
+                    cpus.push_back(cpu);
+
+                if (file.peek() == ',')
+                    file >> separator;
+            }
+
+            if (!cpus.empty())
+                t.cpus.push_back(std::move(cpus));
+        }
+
+        if (t.cpus.size() < 2) {
+            t.cpus.clear();
+            return t;
+        }
+
+        for (unsigned node = 0; node < t.cpus.size(); node++) {
+            for (const int cpu : t.cpus[node]) {
+                if (static_cast<unsigned>(cpu) >= t.nodeOf.size())
+                    t.nodeOf.resize(cpu + 1);
+                t.nodeOf[cpu] = node;
+            }
+        }
+#endif
+        return t;
+    }();
+
+    return topology;
+}
+
+// Returns the node, numbered like getNumaTopology's, of the CPU the calling thread currently runs on.
+static unsigned getCurrentNode() noexcept {
+#ifdef __linux__
+    const auto & nodeOf = getNumaTopology().nodeOf;
+    const int cpu = sched_getcpu();
+
+    if (cpu >= 0 && static_cast<unsigned>(cpu) < nodeOf.size())
+        return nodeOf[cpu];
+#endif
+    return 0;
+}
+
+// Fills order with the row-major position of every coefficient of a size x size block, taken in the zigzag scan order of JPEG.
+static void zigzagOrder(const int size, int * order) noexcept {
+    for (int diagonal = 0, i = 0; diagonal < 2 * size - 1; diagonal++) {
+        const int first = std::max(diagonal - size + 1, 0);
+        const int last = std::min(diagonal, size - 1);
+
+        for (int j = first; j <= last; j++) {
+            const int y = (diagonal & 1) ? j : first + last - j;
+            order[i++] = size * y + diagonal - y;
+        }
+    }
+}
+
+// Splits a size x size weight matrix into vertical and horizontal vectors with weights[size * y + x] == vertical[y] * horizontal[x], if possible.
+static bool separate(const double * weights, const int size, double * vertical, double * horizontal) noexcept {
+    int pivot = 0;
+
+    for (int i = 1; i < size * size; i++) {
+        if (weights[i] > weights[pivot])
+            pivot = i;
+    }
+
+    const double scale = weights[pivot];
+
+    for (int i = 0; i < size; i++) {
+        vertical[i] = scale > 0. ? weights[size * i + pivot % size] / scale : 0.;
+        horizontal[i] = weights[size * (pivot / size) + i];
+    }
+
+    for (int y = 0; y < size; y++) {
+        for (int x = 0; x < size; x++) {
+            if (std::abs(weights[size * y + x] - vertical[y] * horizontal[x]) > 1e-9)
+                return false;
+        }
+    }
+
+    return true;
+}
+
+static void filterFFTW(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept {
+    int i = 0;
+    while (d->fftwBlocks[i] != count)
+        i++;
+
+    fftwf_execute_r2r(d->dct[i], blocks, blocks);
+
+    const int coefficients = d->size * d->size;
+
+    for (unsigned j = 0; j < count; j++) {
+        float * VS_RESTRICT block = blocks + coefficients * j;
+
+        for (int k = 0; k < coefficients; k++)
+            block[k] *= d->factors[k];
+    }
+
+    fftwf_execute_r2r(d->idct[i], blocks, blocks);
+}
+
+// The two halves of filterFFTW for the coefficient modes, each with its own scaling in the factors.
+template<bool inverse>
+static void transformFFTW(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept {
+    int i = 0;
+    while (d->fftwBlocks[i] != count)
+        i++;
+
+    if (!inverse)
+        fftwf_execute_r2r(d->dct[i], blocks, blocks);
+
+    const int coefficients = d->size * d->size;
+
+    for (unsigned j = 0; j < count; j++) {
+        float * VS_RESTRICT block = blocks + coefficients * j;
+
+        for (int k = 0; k < coefficients; k++)
+            block[k] *= d->factors[k];
+    }
+
+    if (inverse)
+        fftwf_execute_r2r(d->idct[i], blocks, blocks);
+}
+
+static void analyzeFFTW(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept {
+    int i = 0;
+    while (d->fftwBlocks[i] != count)
+        i++;
+
+    fftwf_execute_r2r(d->dct[i], blocks, blocks);
+}
+
+// Loads the N rows starting at top into count blocks whose first column is left, replicating the plane's edges for pixels outside it.
+template<typename T, int N, typename U>
+static inline void gather(const T * srcp, const int stride, const int width, const int height, const int top, const int left, const int count,
+                          U * VS_RESTRICT buffer) noexcept {
+    for (int yy = 0; yy < N; yy++) {
+        const T * input = srcp + stride * std::min(std::max(top + yy, 0), height - 1);
+
+        for (int i = 0; i < count; i++) {
+            const int x = left + N * i;
+            U * VS_RESTRICT output = buffer + N * N * i + N * yy;
+
+            if (x >= 0 && x + N <= width) {
+                for (int xx = 0; xx < N; xx++)
+                    output[xx] = input[x + xx];
+            } else {
+                for (int xx = 0; xx < N; xx++)
+                    output[xx] = input[std::min(std::max(x + xx, 0), width - 1)];
+            }
+        }
+    }
+}
+
+// Like gather, but loads every pixel as the weighted sum of the same pixel in each of the given frames.
+template<typename T, int N>
+static inline void blend(const T * const * srcp, const int * stride, const float * weights, const int frames, const int width, const int height,
+                         const int top, const int left, const int count, float * VS_RESTRICT buffer) noexcept {
+    for (int yy = 0; yy < N; yy++) {
+        const int y = std::min(std::max(top + yy, 0), height - 1);
+
+        for (int j = 0; j < frames; j++) {
+            const T * input = srcp[j] + stride[j] * y;
+            const float weight = weights[j];
+
+            for (int i = 0; i < count; i++) {
+                const int x = left + N * i;
+                float * VS_RESTRICT output = buffer + N * N * i + N * yy;
+
+                if (x >= 0 && x + N <= width) {
+                    if (j) {
+                        for (int xx = 0; xx < N; xx++)
+                            output[xx] += weight * input[x + xx];
+                    } else {
+                        for (int xx = 0; xx < N; xx++)
+                            output[xx] = weight * input[x + xx];
+                    }
+                } else {
+                    for (int xx = 0; xx < N; xx++)
+                        output[xx] = (j ? output[xx] : 0.f) + weight * input[std::min(std::max(x + xx, 0), width - 1)];
+                }
+            }
+        }
+    }
+}
+
+// Adds rows [first, last) of count filtered blocks whose first column is left onto consecutive accumulator rows, dropping pixels outside the plane.
+template<int N>
+static inline void accumulate(const float * VS_RESTRICT buffer, float * VS_RESTRICT acc, const int width, const int left, const int count, const int first,
+                              const int last) noexcept {
+    for (int yy = first; yy < last; yy++, acc += width) {
+        for (int i = 0; i < count; i++) {
+            const int x = left + N * i;
+            const float * input = buffer + N * N * i + N * yy;
+
+            for (int xx = std::max(-x, 0); xx < std::min(width - x, N); xx++)
+                acc[x + xx] += input[xx];
+        }
+    }
+}
+
+template<typename T>
+static inline T toPixel(const float value, const float peak) noexcept {
+    if (std::is_integral<T>::value)
+        return static_cast<T>(std::min(std::max(value, 0.f), peak) + 0.5f);
+    else
+        return static_cast<T>(value);
+}
+
+// A half precision sample. Planes of them are only ever accessed through the Half overloads below, which convert the part of the plane a
+// tile covers with d->loadHalf and d->storeHalf and hand plain floats to the rest.
+struct Half {
+    uint16_t bits;
+};
+
+static inline float halfToFloat(const uint16_t h) noexcept {
+    const uint32_t sign = (h & 0x8000u) << 16;
+    const uint32_t exponent = (h >> 10) & 0x1F;
+    const uint32_t mantissa = h & 0x3FF;
+    uint32_t bits;
+
+    if (exponent == 0x1F) {
+        // NaNs come out quiet, as they do from the hardware conversions.
+        bits = sign | 0x7F800000u | (mantissa << 13) | (mantissa ? 0x400000u : 0);
+    } else if (exponent) {
+        bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+    } else {
+        // Subnormals are exact in single precision.
+        float value = mantissa * 5.9604644775390625e-8f;
+        std::memcpy(&bits, &value, 4);
+        bits |= sign;
+    }
+
+    float value;
+    std::memcpy(&value, &bits, 4);
+    return value;
+}
+
+// Rounds to nearest even like the F16C and NEON conversions.
+static inline uint16_t floatToHalf(const float value) noexcept {
+    uint32_t bits;
+    std::memcpy(&bits, &value, 4);
+
+    const uint16_t sign = static_cast<uint16_t>((bits >> 16) & 0x8000);
+    const uint32_t magnitude = bits & 0x7FFFFFFFu;
+
+    if (magnitude >= 0x7F800000u)
+        return sign | 0x7C00 | (magnitude > 0x7F800000u ? 0x200 | ((magnitude >> 13) & 0x3FF) : 0);
+
+    // Below 2^-14 the spacing of half precision values is fixed, and adding 0.5 brings the result into the lowest float binade, whose
+    // mantissa then holds the rounded half.
+    if (magnitude < 0x38800000u) {
+        float absolute;
+        std::memcpy(&absolute, &magnitude, 4);
+        absolute += 0.5f;
+        uint32_t rounded;
+        std::memcpy(&rounded, &absolute, 4);
+        return sign | static_cast<uint16_t>(rounded - 0x3F000000u);
+    }
+
+    const uint32_t rounded = magnitude + 0xFFF + ((magnitude >> 13) & 1) - (112u << 23);
+    return rounded >= (31u << 23) ? sign | 0x7C00 : sign | static_cast<uint16_t>(rounded >> 13);
+}
+
+static void loadHalfC(const uint16_t * VS_RESTRICT src, float * VS_RESTRICT dst, const unsigned n) noexcept {
+    for (unsigned i = 0; i < n; i++)
+        dst[i] = halfToFloat(src[i]);
+}
+
+static void storeHalfC(const float * VS_RESTRICT src, uint16_t * VS_RESTRICT dst, const unsigned n) noexcept {
+    for (unsigned i = 0; i < n; i++)
+        dst[i] = floatToHalf(src[i]);
+}
+
+// Columns [x0, x1) and rows [y0, y1) of a plane read by gather for count blocks starting at top and left.
+struct Region {
+    int x0, x1, y0, y1;
 };
 
+// Converts the region of a half precision plane which a tile reads to floats, stored row by row at scratch. Gathering from these rows with
+// the tile's position relative to the region and the region's size as the plane's replicates the same edges.
+template<int N>
+static inline Region stage(const Half * srcp, const int stride, const int width, const int height, const int top, const int left, const int count,
+                           float * VS_RESTRICT scratch, const DCTFilterData * d) noexcept {
+    const Region r{ std::min(std::max(left, 0), width - 1), std::min(left + N * count, width), std::min(std::max(top, 0), height - 1),
+                    std::min(top + N, height) };
+    const int span = r.x1 - r.x0;
+
+    for (int y = r.y0; y < r.y1; y++)
+        d->loadHalf(reinterpret_cast<const uint16_t *>(srcp + stride * y + r.x0), scratch + span * (y - r.y0), span);
+
+    return r;
+}
+
+template<int N, typename T>
+static inline void load(const T * srcp, const int stride, const int width, const int height, const int top, const int left, const int count,
+                        float * VS_RESTRICT buffer, float * VS_RESTRICT, const DCTFilterData *) noexcept {
+    gather<T, N>(srcp, stride, width, height, top, left, count, buffer);
+}
+
+template<int N>
+static inline void load(const Half * srcp, const int stride, const int width, const int height, const int top, const int left, const int count,
+                        float * VS_RESTRICT buffer, float * VS_RESTRICT scratch, const DCTFilterData * d) noexcept {
+    const Region r = stage<N>(srcp, stride, width, height, top, left, count, scratch, d);
+    const int span = r.x1 - r.x0;
+    gather<float, N>(scratch, span, span, r.y1 - r.y0, top - r.y0, left - r.x0, count, buffer);
+}
+
+template<int N, typename T>
+static inline void loadBlend(const T * const * srcp, const int * stride, const float * weights, const int frames, const int width, const int height,
+                             const int top, const int left, const int count, float * VS_RESTRICT buffer, float * VS_RESTRICT,
+                             const DCTFilterData *) noexcept {
+    blend<T, N>(srcp, stride, weights, frames, width, height, top, left, count, buffer);
+}
+
+// Each frame's region takes at most as many floats as the tile itself.
+template<int N>
+static inline void loadBlend(const Half * const * srcp, const int * stride, const float * weights, const int frames, const int width, const int height,
+                             const int top, const int left, const int count, float * VS_RESTRICT buffer, float * VS_RESTRICT scratch,
+                             const DCTFilterData * d) noexcept {
+    const float * staged[15];
+    int spans[15];
+    Region r{};
+
+    for (int j = 0; j < frames; j++) {
+        r = stage<N>(srcp[j], stride[j], width, height, top, left, count, scratch + N * N * count * j, d);
+        staged[j] = scratch + N * N * count * j;
+        spans[j] = r.x1 - r.x0;
+    }
+
+    blend<float, N>(staged, spans, weights, frames, spans[0], r.y1 - r.y0, top - r.y0, left - r.x0, count, buffer);
+}
+
+// Writes the first rows of count filtered blocks starting at left, dropping pixels past the plane's width.
+template<int N, typename T>
+static inline void store(const float * VS_RESTRICT buffer, T * dstp, const int stride, const int width, const int rows, const int left, const int count,
+                         const float peak, float * VS_RESTRICT, const DCTFilterData *) noexcept {
+    for (int yy = 0; yy < rows; yy++) {
+        T * output = dstp + stride * yy;
+
+        for (int x = left; x < std::min(left + N * count, width); x += N) {
+            const float * input = buffer + N * (x - left) + N * yy;
+
+            for (int xx = 0; xx < std::min(width - x, N); xx++)
+                output[x + xx] = toPixel<T>(input[xx], peak);
+        }
+    }
+}
+
+template<int N>
+static inline void store(const float * VS_RESTRICT buffer, Half * dstp, const int stride, const int width, const int rows, const int left, const int count,
+                         const float, float * VS_RESTRICT scratch, const DCTFilterData * d) noexcept {
+    const int span = std::min(left + N * count, width) - left;
+
+    for (int yy = 0; yy < rows; yy++) {
+        for (int x = 0; x < span; x += N)
+            std::copy_n(buffer + N * x + N * yy, std::min(span - x, N), scratch + x);
+
+        d->storeHalf(scratch, reinterpret_cast<uint16_t *>(dstp + stride * yy + left), span);
+    }
+}
+
+template<typename T>
+static inline void storeRow(const float * VS_RESTRICT input, T * output, const int width, const float peak, const DCTFilterData *) noexcept {
+    for (int x = 0; x < width; x++)
+        output[x] = toPixel<T>(input[x], peak);
+}
+
+static inline void storeRow(const float * VS_RESTRICT input, Half * output, const int width, const float, const DCTFilterData * d) noexcept {
+    d->storeHalf(input, reinterpret_cast<uint16_t *>(output), width);
+}
+
+template<int N, typename U>
+static inline bool isFlat(const U * VS_RESTRICT block, const float threshold) noexcept {
+    U lo[N], hi[N];
+    std::copy_n(block, N, lo);
+    std::copy_n(block, N, hi);
+
+    // Column-wise extremes first, so the rows reduce with plain vector min and max.
+    for (int k = N; k < N * N; k += N) {
+        for (int xx = 0; xx < N; xx++) {
+            lo[xx] = std::min(lo[xx], block[k + xx]);
+            hi[xx] = std::max(hi[xx], block[k + xx]);
+        }
+    }
+
+    return *std::max_element(hi, hi + N) - *std::min_element(lo, lo + N) <= threshold;
+}
+
+// Runs the kernel over count gathered blocks, or with a flat threshold over each run of consecutive blocks which are not flat. A flat block
+// keeps its pixels, multiplied by scale to match the weights, which already hold the overlap average, and the kernel never sees it. Returns
+// the number of flat blocks.
+template<int N, typename U>
+static inline unsigned filterTile(U * VS_RESTRICT blocks, const int count, void (*filter)(U * VS_RESTRICT, const unsigned, const DCTFilterData * VS_RESTRICT),
+                                  const float scale, const DCTFilterData * d) noexcept {
+    if (d->flat <= 0.f) {
+        filter(blocks, count, d);
+        return 0;
+    }
+
+    unsigned skipped = 0;
+    int run = 0;
+
+    for (int i = 0; i < count; i++) {
+        U * VS_RESTRICT block = blocks + N * N * i;
+
+        if (!isFlat<N>(block, d->flat))
+            continue;
+
+        if (run < i)
+            filter(blocks + N * N * run, i - run, d);
+
+        if (scale != 1.f) {
+            for (int k = 0; k < N * N; k++)
+                block[k] = static_cast<U>(block[k] * scale);
+        }
+
+        run = i + 1;
+        skipped++;
+    }
+
+    if (run < count)
+        filter(blocks + N * N * run, count - run, d);
+
+    return skipped;
+}
+
+// Specialized per sample type, bit depth and block size N so the peak and the block loops are compile-time constants; bits == 0 takes
+// the peak from d (float ignores it). A strip is one row of blocks, N pixel rows high.
+template<typename T, int bits, int N>
+static int64_t process(const VSFrame * const * src, VSFrame * dst, const int plane, const int firstStrip, const int lastStrip,
+                       float * VS_RESTRICT buffer, DCTFilterSeam * above, DCTFilterSeam * below, const DCTFilterData * d, const VSAPI * vsapi) noexcept {
+    const float peak = static_cast<float>(bits ? (1 << bits) - 1 : d->peak);
+
+    const int width = vsapi->getFrameWidth(dst, plane);
+    const int height = vsapi->getFrameHeight(dst, plane);
+    const int stride = vsapi->getStride(dst, plane) / sizeof(T);
+    // Not restricted, as dst is src itself when filtering in place.
+    T * dstp = reinterpret_cast<T *>(vsapi->getWritePtr(dst, plane)) + stride * N * firstStrip;
+
+    const int frames = 2 * d->radius + 1;
+    const T * srcp[15];
+    int srcStride[15];
+
+    for (int j = 0; j < frames; j++) {
+        srcp[j] = reinterpret_cast<const T *>(vsapi->getReadPtr(src[j], plane));
+        srcStride[j] = vsapi->getStride(src[j], plane) / sizeof(T);
+    }
+
+    float * VS_RESTRICT scratch = buffer + d->halfOffset;
+
+    auto loadTile = [&](const int top, const int left, const int count) {
+        if (d->radius)
+            loadBlend<N>(srcp, srcStride, d->temporal, frames, width, height, top, left, count, buffer, scratch, d);
+        else
+            load<N>(srcp[0], srcStride[0], width, height, top, left, count, buffer, scratch, d);
+    };
+
+    const int blocks = (width + N - 1) / N;
+    const int lastRow = std::min(N * lastStrip, height);
+    int64_t skipped = 0;
+
+    if (d->overlap == 1) {
+        for (int y = N * firstStrip; y < lastRow; y += N) {
+            // A tile's source rows are still cached when its pixels are written back.
+            for (int first = 0; first < blocks; first += d->tileBlocks) {
+                const int count = std::min(blocks - first, d->tileBlocks);
+                const int left = N * first;
+
+                loadTile(y, left, count);
+                skipped += filterTile<N>(buffer, count, d->filter, 1.f, d);
+                store<N>(buffer, dstp, stride, width, std::min(height - y, N), left, count, peak, scratch, d);
+            }
+
+            dstp += stride * N;
+        }
+
+        return skipped;
+    }
+
+    // Every grid covers each pixel exactly once and the 1 / overlap average is folded into the weights, so the output is the plain sum of
+    // all grids. The accumulator holds the current strip followed by the lower half of the vertically shifted blocks, which carries over.
+    constexpr int half = N / 2;
+    const float scale = 1.f / d->overlap;
+    const int shiftedBlocks = (width + half + N - 1) / N;
+    float * VS_RESTRICT acc = buffer + N * N * shiftedBlocks;
+
+    // Adds the other run's partial sums of the rows at a seam to this one's, stored at rows, and writes them if the other run is done.
+    auto meet = [&](DCTFilterSeam * seam, const int side, float * VS_RESTRICT rows, T * out, const int count) {
+        std::copy_n(rows, count * width, seam->rows[side]);
+
+        if (seam->arrivals.fetch_add(1, std::memory_order_acq_rel)) {
+            for (int i = 0; i < count * width; i++)
+                rows[i] += seam->rows[!side][i];
+
+            for (int yy = 0; yy < count; yy++)
+                storeRow(rows + width * yy, out + stride * yy, width, peak, d);
+        }
+    };
+
+    std::fill_n(acc, (N + half) * width, 0.f);
+
+    // The shifted blocks above the first strip are transformed here only at the top of the plane; below a seam the run above has them.
+    for (int grid = 0; grid < d->overlap && !above; grid++) {
+        const int left = -d->shifts[grid][1];
+        const int count = left ? shiftedBlocks : blocks;
+
+        if (d->shifts[grid][0]) {
+            for (int first = 0; first < count; first += d->tileBlocks) {
+                const int tile = std::min(count - first, d->tileBlocks);
+
+                loadTile(N * firstStrip - half, left + N * first, tile);
+                skipped += filterTile<N>(buffer, tile, d->filter, scale, d);
+                accumulate<N>(buffer, acc, width, left + N * first, tile, half, N);
+            }
+        }
+    }
+
+    for (int y = N * firstStrip; y < lastRow; y += N) {
+        for (int grid = 0; grid < d->overlap; grid++) {
+            const int top = y + d->shifts[grid][0];
+            const int left = -d->shifts[grid][1];
+            const int count = left ? shiftedBlocks : blocks;
+
+            if (top >= height)
+                continue;
+
+            for (int first = 0; first < count; first += d->tileBlocks) {
+                const int tile = std::min(count - first, d->tileBlocks);
+
+                loadTile(top, left + N * first, tile);
+                skipped += filterTile<N>(buffer, tile, d->filter, scale, d);
+                accumulate<N>(buffer, acc + width * d->shifts[grid][0], width, left + N * first, tile, 0, std::min(height - top, N));
+            }
+        }
+
+        int yy = 0;
+
+        if (above && y == N * firstStrip) {
+            yy = std::min(height - y, half);
+            meet(above, 1, acc, dstp, yy);
+        }
+
+        for (; yy < std::min(height - y, N); yy++)
+            storeRow(acc + width * yy, dstp + stride * yy, width, peak, d);
+
+        std::copy_n(acc + N * width, half * width, acc);
+        std::fill_n(acc + half * width, N * width, 0.f);
+        dstp += stride * N;
+    }
+
+    if (below)
+        meet(below, 0, acc, dstp, std::min(height - lastRow, half));
+
+    return skipped;
+}
+
+// Fixed-point counterpart of process for 8x8 blocks of 8-10 bit samples. The strip is gathered as 16-bit integers and the kernel already
+// returns clamped pixels.
 template<typename T>
-static void process(const VSFrameRef * src, VSFrameRef * dst, const DCTFilterData * d, const VSAPI * vsapi) noexcept {
-    const auto threadId = std::this_thread::get_id();
-    float * VS_RESTRICT buffer = d->buffer.at(threadId);
-
-    for (int plane = 0; plane < d->vi->format->numPlanes; plane++) {
-        if (d->process[plane]) {
-            const int width = vsapi->getFrameWidth(src, plane);
-            const int height = vsapi->getFrameHeight(src, plane);
-            const int stride = vsapi->getStride(src, plane) / sizeof(T);
-            const T * srcp = reinterpret_cast<const T *>(vsapi->getReadPtr(src, plane));
-            T * VS_RESTRICT dstp = reinterpret_cast<T *>(vsapi->getWritePtr(dst, plane));
-
-            for (int y = 0; y < height; y += 8) {
-                for (int x = 0; x < width; x += 8) {
-                    for (int yy = 0; yy < 8; yy++) {
-                        const T * input = srcp + stride * yy + x;
-                        float * VS_RESTRICT output = buffer + 8 * yy;
-
-                        for (int xx = 0; xx < 8; xx++)
-                            output[xx] = input[xx] * (1.f / 256.f);
+static int64_t processFixed(const VSFrame * const * frames, VSFrame * dst, const int plane, const int firstStrip, const int lastStrip,
+                            float * VS_RESTRICT buffer, DCTFilterSeam *, DCTFilterSeam *, const DCTFilterData * d, const VSAPI * vsapi) noexcept {
+    const VSFrame * src = frames[0];
+    const int width = vsapi->getFrameWidth(src, plane);
+    const int height = vsapi->getFrameHeight(src, plane);
+    const int stride = vsapi->getStride(src, plane) / sizeof(T);
+    const T * srcp = reinterpret_cast<const T *>(vsapi->getReadPtr(src, plane));
+    T * dstp = reinterpret_cast<T *>(vsapi->getWritePtr(dst, plane)) + stride * 8 * firstStrip;
+    int16_t * VS_RESTRICT blocks = reinterpret_cast<int16_t *>(buffer);
+
+    const int total = (width + 7) / 8;
+    int64_t skipped = 0;
+
+    for (int y = 8 * firstStrip; y < std::min(8 * lastStrip, height); y += 8) {
+        for (int first = 0; first < total; first += d->tileBlocks) {
+            const int count = std::min(total - first, d->tileBlocks);
+            const int left = 8 * first;
+
+            gather<T, 8>(srcp, stride, width, height, y, left, count, blocks);
+            skipped += filterTile<8>(blocks, count, d->fixedFilter, 1.f, d);
+
+            for (int yy = 0; yy < std::min(height - y, 8); yy++) {
+                T * output = dstp + stride * yy;
+
+                for (int x = left; x < std::min(left + 8 * count, width); x += 8) {
+                    const int16_t * input = blocks + 8 * (x - left) + 8 * yy;
+
+                    for (int xx = 0; xx < std::min(width - x, 8); xx++)
+                        output[x + xx] = static_cast<T>(input[xx]);
+                }
+            }
+        }
+
+        dstp += stride * 8;
+    }
+
+    return skipped;
+}
+
+// Counterpart of process for the coefficient modes, where one side is a float plane holding each block's coefficients in place of its
+// pixels, padded to whole blocks. T is the sample type of the pixel side, and the output decides which blocks there are.
+template<typename T, int N, bool inverse>
+static int64_t processCoefficients(const VSFrame * const * frames, VSFrame * dst, const int plane, const int firstStrip, const int lastStrip,
+                                   float * VS_RESTRICT buffer, DCTFilterSeam *, DCTFilterSeam *, const DCTFilterData * d, const VSAPI * vsapi) noexcept {
+    const VSFrame * src = frames[0];
+    typedef typename std::conditional<inverse, float, T>::type S;
+    typedef typename std::conditional<inverse, T, float>::type D;
+
+    const float peak = static_cast<float>(d->peak);
+
+    const int srcWidth = vsapi->getFrameWidth(src, plane);
+    const int srcHeight = vsapi->getFrameHeight(src, plane);
+    const int srcStride = vsapi->getStride(src, plane) / sizeof(S);
+    const int width = vsapi->getFrameWidth(dst, plane);
+    const int height = vsapi->getFrameHeight(dst, plane);
+    const int stride = vsapi->getStride(dst, plane) / sizeof(D);
+    const S * srcp = reinterpret_cast<const S *>(vsapi->getReadPtr(src, plane));
+    D * VS_RESTRICT dstp = reinterpret_cast<D *>(vsapi->getWritePtr(dst, plane)) + stride * N * firstStrip;
+    float * VS_RESTRICT scratch = buffer + d->halfOffset;
+
+    const int blocks = (width + N - 1) / N;
+
+    for (int y = N * firstStrip; y < std::min(N * lastStrip, height); y += N) {
+        for (int first = 0; first < blocks; first += d->tileBlocks) {
+            const int count = std::min(blocks - first, d->tileBlocks);
+            const int left = N * first;
+
+            load<N>(srcp, srcStride, srcWidth, srcHeight, y, left, count, buffer, scratch, d);
+            d->filter(buffer, count, d);
+            store<N>(buffer, dstp, stride, width, std::min(height - y, N), left, count, peak, scratch, d);
+        }
+
+        dstp += stride * N;
+    }
+
+    return 0;
+}
+
+// Adds the orthonormal energy of each band over the unshifted blocks of strips [firstStrip, lastStrip) to sums. Each tile is summed per
+// coefficient first, which vectorizes, and only then folded into the bands.
+template<typename T, int N>
+static void measure(const VSFrame * src, const int plane, const int firstStrip, const int lastStrip, float * VS_RESTRICT buffer, double * sums,
+                    const DCTFilterData * d, const VSAPI * vsapi) noexcept {
+    const int width = vsapi->getFrameWidth(src, plane);
+    const int height = vsapi->getFrameHeight(src, plane);
+    const int stride = vsapi->getStride(src, plane) / sizeof(T);
+    const T * srcp = reinterpret_cast<const T *>(vsapi->getReadPtr(src, plane));
+
+    const int blocks = (width + N - 1) / N;
+
+    for (int y = N * firstStrip; y < std::min(N * lastStrip, height); y += N) {
+        for (int first = 0; first < blocks; first += d->tileBlocks) {
+            const int count = std::min(blocks - first, d->tileBlocks);
+            float energy[N * N] = {};
+
+            load<N>(srcp, stride, width, height, y, N * first, count, buffer, buffer + d->halfOffset, d);
+            d->analyze(buffer, count, d);
+
+            for (int i = 0; i < count; i++) {
+                const float * block = buffer + N * N * i;
+
+                for (int k = 0; k < N * N; k++)
+                    energy[k] += block[k] * block[k];
+            }
+
+            for (int k = 0; k < N * N; k++)
+                sums[d->bands[k]] += static_cast<double>(energy[k]) * d->energyScale[k];
+        }
+    }
+}
+
+// A thread takes the first free slot of its own NUMA node, and only then one of another node. On hosts with several nodes the slots are
+// allocated by whichever thread claims them first, which places their pages on that thread's node.
+static float * acquireBuffer(const DCTFilterData * d, unsigned & slot) noexcept {
+    const unsigned first = d->nodes > 1 ? d->slots / d->nodes * getCurrentNode() : 0;
+
+    for (unsigned i = 0; i < d->slots; i++) {
+        slot = (first + i) % d->slots;
+
+        if (!d->busy[slot].exchange(true, std::memory_order_acquire)) {
+            if (!d->buffer[slot] && !(d->buffer[slot] = fftwf_alloc_real(d->bufferSize))) {
+                d->busy[slot].store(false, std::memory_order_release);
+                return nullptr;
+            }
+
+            return d->buffer[slot];
+        }
+    }
+
+    slot = d->slots;
+
+    // The slots cover every caller and helper that can run at once, so this is only reachable when the core's thread count was raised
+    // after the filter was created.
+    return fftwf_alloc_real(d->bufferSize);
+}
+
+static void releaseBuffer(const DCTFilterData * d, float * buffer, const unsigned slot) noexcept {
+    if (slot < d->slots)
+        d->busy[slot].store(false, std::memory_order_release);
+    else
+        fftwf_free(buffer);
+}
+
+// Every frame in flight claims a free set of seams and allocates its rows the first time. Only when the core's thread count was raised after
+// the filter was created can every set be taken, and the frame then waits for one to be released.
+static DCTFilterSeam * acquireSeams(const DCTFilterData * d, unsigned & set) noexcept {
+    const size_t count = d->tasks.size();
+
+    for (;;) {
+        for (set = 0; set < d->seamSets; set++) {
+            if (d->seamsBusy[set].exchange(true, std::memory_order_acquire))
+                continue;
+
+            DCTFilterSeam * seams = &d->seams[count * set];
+
+            if (!d->seamRows[set]) {
+                if (!(d->seamRows[set] = fftwf_alloc_real(d->seamSize))) {
+                    d->seamsBusy[set].store(false, std::memory_order_release);
+                    return nullptr;
+                }
+
+                float * rows = d->seamRows[set];
+
+                for (size_t i = 0; i + 1 < count; i++) {
+                    if (d->tasks[i + 1].plane == d->tasks[i].plane) {
+                        seams[i].rows[0] = rows;
+                        seams[i].rows[1] = rows + d->size / 2 * d->tasks[i].width;
+                        rows += d->size * d->tasks[i].width;
                     }
+                }
+            }
+
+            for (size_t i = 0; i < count; i++)
+                seams[i].arrivals.store(0, std::memory_order_relaxed);
+
+            return seams;
+        }
+
+        std::this_thread::yield();
+    }
+}
+
+static void releaseSeams(const DCTFilterData * d, const unsigned set) noexcept {
+    d->seamsBusy[set].store(false, std::memory_order_release);
+}
+
+// Every FFTW planner call goes through plannerMutex. Executing a plan on new arrays is thread-safe, so instances share identical plans.
+struct CachedPlan {
+    fftwf_plan plan;
+    unsigned refs;
+};
+
+static std::mutex plannerMutex;
+static std::map<std::tuple<int, unsigned, bool, unsigned>, CachedPlan> planCache;
+static std::set<std::string> importedWisdom;
+
+// Process-wide counters reported by Stats, covering every frame of every instance. The map only grows, so instances keep a pointer to
+// their own backend's counter.
+static std::atomic<int64_t> totalFrames{ 0 }, totalBlocks{ 0 }, totalTime{ 0 };
+static std::mutex statsMutex;
+static std::map<std::string, std::atomic<int64_t>> backendFrames;
+
+static fftwf_plan acquirePlan(const int size, const unsigned blocks, const bool inverse, const unsigned flags, float * buffer, bool & created) {
+    auto & cached = planCache[std::make_tuple(size, blocks, inverse, flags)];
+
+    if (!cached.plan) {
+        const int n[] = { size, size };
+        const fftwf_r2r_kind kind[] = { inverse ? FFTW_REDFT01 : FFTW_REDFT10, inverse ? FFTW_REDFT01 : FFTW_REDFT10 };
+
+        cached.plan = fftwf_plan_many_r2r(2, n, blocks, buffer, nullptr, 1, size * size, buffer, nullptr, 1, size * size, kind, flags);
+        if (!cached.plan)
+            throw std::string{ "failed to create FFTW plan" };
+
+        created = true;
+    }
+
+    cached.refs++;
+    return cached.plan;
+}
+
+static void releasePlans(DCTFilterData * d) {
+    std::lock_guard<std::mutex> lock{ plannerMutex };
+
+    for (int i = 0; i < 4; i++) {
+        for (auto plan : { d->dct[i], d->idct[i] }) {
+            if (!plan)
+                continue;
+
+            const auto iter = std::find_if(planCache.begin(), planCache.end(), [&](const decltype(planCache)::value_type & entry) {
+                return entry.second.plan == plan;
+            });
+
+            if (--iter->second.refs == 0) {
+                fftwf_destroy_plan(iter->second.plan);
+                planCache.erase(iter);
+            }
+        }
+    }
+}
+
+// One pool per NUMA node, its helpers pinned to the node's CPUs, so that the helpers of a frame share the caches and memory of the thread
+// which submitted it. Without NUMA there is a single pool of unpinned helpers.
+static std::mutex poolMutex;
+static std::vector<ThreadPool *> pools;
+static unsigned poolUsers;
+
+static std::vector<ThreadPool *> acquirePools() {
+    std::lock_guard<std::mutex> lock{ poolMutex };
+
+    if (pools.empty()) {
+        const auto & nodes = getNumaTopology().cpus;
+
+        if (nodes.empty())
+            pools.push_back(new ThreadPool{ std::max(std::thread::hardware_concurrency(), 2u) - 1 });
+
+        for (const auto & cpus : nodes)
+            pools.push_back(new ThreadPool{ std::max(static_cast<unsigned>(cpus.size()), 2u) - 1, cpus });
+    }
+
+    poolUsers++;
+    return pools;
+}
+
+static void releasePools() {
+    std::lock_guard<std::mutex> lock{ poolMutex };
+
+    if (--poolUsers == 0) {
+        for (auto pool : pools)
+            delete pool;
+        pools.clear();
+    }
+}
+
+template<int N>
+static void selectProcess(DCTFilterData * d) noexcept {
+    if (d->mode) {
+        const bool inverse = d->mode == 2;
+        const VSVideoFormat & format = inverse ? d->outputInfo.format : d->vi->format;
+
+        if (format.bytesPerSample == 1)
+            d->processPlane = inverse ? processCoefficients<uint8_t, N, true> : processCoefficients<uint8_t, N, false>;
+        else if (format.sampleType == stFloat && format.bytesPerSample == 2)
+            d->processPlane = inverse ? processCoefficients<Half, N, true> : processCoefficients<Half, N, false>;
+        else if (format.bytesPerSample == 2)
+            d->processPlane = inverse ? processCoefficients<uint16_t, N, true> : processCoefficients<uint16_t, N, false>;
+        else
+            d->processPlane = inverse ? processCoefficients<float, N, true> : processCoefficients<float, N, false>;
+    } else if (d->vi->format.sampleType == stFloat)
+        d->processPlane = d->vi->format.bytesPerSample == 2 ? process<Half, 0, N> : process<float, 0, N>;
+    else if (d->vi->format.bytesPerSample == 1)
+        d->processPlane = process<uint8_t, 8, N>;
+    else if (d->vi->format.bitsPerSample == 10)
+        d->processPlane = process<uint16_t, 10, N>;
+    else if (d->vi->format.bitsPerSample == 12)
+        d->processPlane = process<uint16_t, 12, N>;
+    else if (d->vi->format.bitsPerSample == 16)
+        d->processPlane = process<uint16_t, 16, N>;
+    else
+        d->processPlane = process<uint16_t, 0, N>;
+
+    if (d->vi->format.bytesPerSample == 1)
+        d->measurePlane = measure<uint8_t, N>;
+    else if (d->vi->format.sampleType == stFloat && d->vi->format.bytesPerSample == 2)
+        d->measurePlane = measure<Half, N>;
+    else if (d->vi->format.bytesPerSample == 2)
+        d->measurePlane = measure<uint16_t, N>;
+    else
+        d->measurePlane = measure<float, N>;
+}
+
+// level is the instruction set to use, numbered like opt.
+template<int N>
+static void selectFilter(DCTFilterData * d, const int level, const bool fused, const bool pruned) noexcept {
+#ifdef DCTFILTER_X86
+    if (level == 4)
+        d->filter = pruned ? prune_avx512<N> : fused ? filter_avx512<N, true> : filter_avx512<N, false>;
+    else if (level == 3)
+        d->filter = pruned ? prune_avx2<N> : fused ? filter_avx2<N, true> : filter_avx2<N, false>;
+    else
+        d->filter = pruned ? prune_sse2<N> : fused ? filter_sse2<N, true> : filter_sse2<N, false>;
+#elif defined(DCTFILTER_ARM)
+    d->filter = pruned ? prune_neon<N> : fused ? filter_neon<N, true> : filter_neon<N, false>;
+#endif
+}
+
+template<int N>
+static void selectAnalyze(DCTFilterData * d, const int level) noexcept {
+#ifdef DCTFILTER_X86
+    d->analyze = level == 4 ? analyze_avx512<N> : level == 3 ? analyze_avx2<N> : analyze_sse2<N>;
+#elif defined(DCTFILTER_ARM)
+    d->analyze = analyze_neon<N>;
+#endif
+}
+
+template<int N>
+static void selectTransform(DCTFilterData * d, const int level, const bool inverse) noexcept {
+#ifdef DCTFILTER_X86
+    if (level == 4)
+        d->filter = inverse ? transform_avx512<N, true> : transform_avx512<N, false>;
+    else if (level == 3)
+        d->filter = inverse ? transform_avx2<N, true> : transform_avx2<N, false>;
+    else
+        d->filter = inverse ? transform_sse2<N, true> : transform_sse2<N, false>;
+#elif defined(DCTFILTER_ARM)
+    d->filter = inverse ? transform_neon<N, true> : transform_neon<N, false>;
+#endif
+}
+
+// Expands the requested factors into size x size weights, moving every factor towards 1 by 1 - strength first so that strength 0 filters
+// nothing and strength 1 filters as requested. Scaling the row and column vector keeps their product separable.
+static void expandWeights(const DCTFilterData * d, const double strength, double * weights) noexcept {
+    const int size = d->size;
+    auto scale = [&](const double factor) { return factor + (1. - strength) * (1. - factor); };
+
+    for (int i = 0; i < size * size; i++) {
+        if (d->numRequested == size)
+            weights[i] = scale(d->requested[i / size]) * scale(d->requested[i % size]);
+        else
+            weights[i] = scale(d->requested[i]);
+    }
+}
+
+// Derives the weight of each frame in the temporal round trip of the centre frame from the temporal factors, moved towards 1 like the
+// spatial ones. The orthonormal DCT-II of length 2 * radius + 1 keeps a constant sequence constant when the lowest factor is 1.
+static void blendWeights(const DCTFilterData * d, const double strength, float * weights) noexcept {
+    const double pi = 3.14159265358979323846;
+    const int frames = 2 * d->radius + 1;
+
+    for (int j = 0; j < frames; j++) {
+        double sum = 0.;
+
+        for (int k = 0; k < frames; k++) {
+            const double factor = d->temporalRequested[k] + (1. - strength) * (1. - d->temporalRequested[k]);
+            const double basis = (k ? 2. : 1.) / frames * std::cos(pi * (2 * d->radius + 1) * k / (2. * frames)) *
+                                 std::cos(pi * (2 * j + 1) * k / (2. * frames));
+            sum += basis * factor;
+        }
+
+        weights[j] = static_cast<float>(sum);
+    }
+}
+
+// Builds the per-coefficient factors, the fused and fixed-point operators and the lists of live frequencies for the given weights, and
+// picks the cheapest kernel of d->level for them.
+static void prepare(DCTFilterData * d, const double * weights) {
+    const int size = d->size;
+    const int coefficients = size * size;
+
+    // The unnormalized round trip has a gain of (2 * size)^2.
+    const double gain = 4. * coefficients;
+
+    for (int i = 0; i < coefficients; i++)
+        d->factors[i] = static_cast<float>(weights[i] / (gain * d->overlap));
+
+    // Same unnormalized DCT-II/DCT-III pair as FFTW's REDFT10/REDFT01, so every backend produces identical coefficients.
+    const double pi = 3.14159265358979323846;
+
+    double dct[16][16], idct[16][16];
+
+    for (int k = 0; k < size; k++) {
+        for (int n = 0; n < size; n++) {
+            dct[k][n] = 2. * std::cos(pi * (2 * n + 1) * k / (2. * size));
+            idct[n][k] = k ? dct[k][n] : 1.;
+
+            d->dctMatrix[size * k + n] = d->dctMatrix[coefficients + size * n + k] = static_cast<float>(dct[k][n]);
+            d->idctMatrix[size * n + k] = d->idctMatrix[coefficients + size * k + n] = static_cast<float>(idct[n][k]);
+        }
+    }
+
+    // When the weights are an outer product a * b^T, IDCT(F .* DCT(X)) == Pv * X * Ph^T with Pv = IDCT * diag(a) * DCT / (2 * size) and Ph
+    // likewise.
+    double vertical[16], horizontal[16];
+    const bool separable = separate(weights, size, vertical, horizontal);
+
+    if (d->fixed && !separable)
+        throw std::string{ "fixed requires separable factors" };
+
+    // Every row of Pv and Ph has an L2 norm of at most 1, so Q14 coefficients fit 16 bits, a row's absolute sum stays below sqrt(8), and
+    // with 13 - bits fractional bits in between neither the 16-bit intermediate rows nor the 32-bit sums of either pass can overflow.
+    d->fixedShift = 13 - d->vi->format.bitsPerSample;
+
+    if (separable) {
+        for (int y = 0; y < size; y++) {
+            for (int x = 0; x < size; x++) {
+                double sumV = 0., sumH = 0.;
+
+                for (int k = 0; k < size; k++) {
+                    sumV += idct[y][k] * vertical[k] * dct[k][x];
+                    sumH += idct[y][k] * horizontal[k] * dct[k][x];
+                }
+
+                d->fusedMatrix[size * y + x] = static_cast<float>(sumV / (2. * size * d->overlap));
+                d->fusedMatrix[coefficients + size * x + y] = static_cast<float>(sumH / (2. * size));
+
+                if (d->fixed) {
+                    d->fixedVertical[8 * y + x] = static_cast<int16_t>(std::lround(sumV / 16. * 16384.));
+                    d->fixedHorizontal[16 * (x / 2) + 2 * y + x % 2] = static_cast<int16_t>(std::lround(sumH / 16. * 16384.));
+                }
+            }
+        }
+    }
+
+    for (int v = 0; v < size; v++) {
+        bool row = false, column = false;
+
+        for (int u = 0; u < size; u++) {
+            row |= weights[size * v + u] != 0.;
+            column |= weights[size * u + v] != 0.;
+        }
+
+        if (row)
+            d->rows[d->numRows++] = v;
+        if (column)
+            d->columns[d->numColumns++] = v;
+    }
+
+    // Counted in block-row vector operations, the fused operator costs 2 * size^2 and the unpruned three-step path 4 * size^2, while the
+    // pruned kernel costs 3 * size per live row plus one per live row and column pair. Its runtime trip counts keep it at about two
+    // thirds the throughput of the fully unrolled kernels, so it only takes over when it saves more than that.
+    const int pruneCost = 3 * (3 * size * d->numRows + d->numRows * d->numColumns);
+    const bool fused = separable && 2 * 2 * coefficients <= pruneCost;
+    const bool pruned = !fused && pruneCost < 2 * (separable ? 2 : 4) * coefficients;
+
+    if (d->level == 1) {
+        d->filter = filterFFTW;
+        d->backend = "FFTW";
+    } else {
+        if (size == 4)
+            selectFilter<4>(d, d->level, fused, pruned);
+        else if (size == 8)
+            selectFilter<8>(d, d->level, fused, pruned);
+        else
+            selectFilter<16>(d, d->level, fused, pruned);
 
-                    fftwf_execute_r2r(d->dct, buffer, buffer);
+        if (d->fixed) {
+#ifdef DCTFILTER_X86
+            d->fixedFilter = d->level >= 3 ? fixed_avx2 : fixed_sse2;
+#elif defined(DCTFILTER_ARM)
+            d->fixedFilter = fixed_neon;
+#endif
+            d->processPlane = d->vi->format.bytesPerSample == 1 ? processFixed<uint8_t> : processFixed<uint16_t>;
+        }
 
-                    for (int i = 0; i < 64; i++)
-                        buffer[i] *= d->factors[i];
+        // The fixed-point path has no AVX-512 kernel.
+        const int isa = d->fixed ? std::min(d->level, 3) : d->level;
+#ifdef DCTFILTER_X86
+        d->backend = isa == 4 ? "AVX-512" : isa == 3 ? "AVX2" : "SSE2";
+#elif defined(DCTFILTER_ARM)
+        d->backend = "NEON";
+#endif
+        d->backend += d->fixed ? " fixed" : fused ? " fused" : pruned ? " pruned" : " full";
+    }
 
-                    fftwf_execute_r2r(d->idct, buffer, buffer);
+    // The coefficient modes only run one half of the round trip, with orthonormal coefficients in between, so that the DC coefficient is
+    // size times the block's mean. ortho scales each frequency of the unnormalized DCT to the orthonormal one.
+    if (d->mode) {
+        const bool inverse = d->mode == 2;
+        double ortho[16];
 
-                    for (int yy = 0; yy < 8; yy++) {
-                        const float * input = buffer + 8 * yy;
-                        T * VS_RESTRICT output = dstp + stride * yy + x;
+        for (int k = 0; k < size; k++)
+            ortho[k] = k ? 1. / std::sqrt(2. * size) : 1. / (2. * std::sqrt(size));
 
-                        for (int xx = 0; xx < 8; xx++) {
-                            if (std::is_integral<T>::value)
-                                output[xx] = std::min(std::max(static_cast<int>(input[xx] + 0.5f), 0), d->peak);
-                            else
-                                output[xx] = input[xx];
-                        }
-                    }
-                }
+        for (int v = 0; v < size; v++) {
+            for (int u = 0; u < size; u++)
+                d->factors[size * v + u] = static_cast<float>(inverse ? 1. / (gain * ortho[v] * ortho[u]) : weights[size * v + u] * ortho[v] * ortho[u]);
+        }
 
-                srcp += stride * 8;
-                dstp += stride * 8;
+        // The SIMD inverse folds the factors into the IDCT matrix instead, one frequency per column.
+        if (inverse) {
+            for (int n = 0; n < size; n++) {
+                for (int k = 0; k < size; k++)
+                    d->idctMatrix[size * n + k] = d->idctMatrix[coefficients + size * k + n] = static_cast<float>(idct[n][k] / (2. * size * ortho[k]));
             }
         }
+
+        if (d->level == 1)
+            d->filter = inverse ? transformFFTW<true> : transformFFTW<false>;
+        else if (size == 4)
+            selectTransform<4>(d, d->level, inverse);
+        else if (size == 8)
+            selectTransform<8>(d, d->level, inverse);
+        else
+            selectTransform<16>(d, d->level, inverse);
+
+        d->backend = d->backend.substr(0, d->backend.find(' ')) + (inverse ? " inverse" : " coeffs");
+    }
+
+    {
+        std::lock_guard<std::mutex> lock{ statsMutex };
+        d->backendFrames = &backendFrames[d->backend];
     }
 }
 
-static void VS_CC dctfilterInit(VSMap *in, VSMap *out, void **instanceData, VSNode *node, VSCore *core, const VSAPI *vsapi) {
-    DCTFilterData * d = static_cast<DCTFilterData *>(*instanceData);
-    vsapi->setVideoInfo(d->vi, 1, node);
+// Returns the operators of the given quantized strength, building them when a frame first asks for it. Everything else stays with d.
+static const DCTFilterData * acquireStrength(DCTFilterData * d, const int step) {
+    DCTFilterData * op = d->strengths[step].load(std::memory_order_acquire);
+    if (op)
+        return op;
+
+    std::lock_guard<std::mutex> lock{ d->strengthMutex };
+
+    op = d->strengths[step].load(std::memory_order_relaxed);
+    if (!op) {
+        op = new DCTFilterData{};
+        op->vi = d->vi;
+        op->mode = d->mode;
+        op->peak = d->peak;
+        op->size = d->size;
+        op->level = d->level;
+        op->fixed = d->fixed;
+        op->overlap = d->overlap;
+        op->flat = d->flat;
+        op->radius = d->radius;
+        op->tileBlocks = d->tileBlocks;
+        op->loadHalf = d->loadHalf;
+        op->storeHalf = d->storeHalf;
+        op->halfOffset = d->halfOffset;
+        op->processPlane = d->processPlane;
+        std::copy_n(&d->shifts[0][0], 8, &op->shifts[0][0]);
+        std::copy_n(d->fftwBlocks, 4, op->fftwBlocks);
+        std::copy_n(d->dct, 4, op->dct);
+        std::copy_n(d->idct, 4, op->idct);
+
+        double weights[256];
+        expandWeights(d, step / 64., weights);
+        prepare(op, weights);
+        blendWeights(d, step / 64., op->temporal);
+
+        d->strengths[step].store(op, std::memory_order_release);
+    }
+
+    return op;
 }
 
-static const VSFrameRef *VS_CC dctfilterGetFrame(int n, int activationReason, void **instanceData, void **frameData, VSFrameContext *frameCtx, VSCore *core, const VSAPI *vsapi) {
-    DCTFilterData * d = static_cast<DCTFilterData *>(*instanceData);
+// One output of DCTFilterMulti. Every output shares the context built for the first clip, which goes away along with the last of them.
+struct DCTFilterClip {
+    std::shared_ptr<DCTFilterData> d;
+    VSNode * node;
+};
+
+static const VSFrame * filterFrame(const int n, const int activationReason, DCTFilterData * d, VSNode * node, VSFrameContext * frameCtx, VSCore * core,
+                                   const VSAPI * vsapi) {
+    // Frames past either end of the clip repeat the first or last one.
+    const int numFrames = vsapi->getVideoInfo(node)->numFrames;
 
     if (activationReason == arInitial) {
-        vsapi->requestFrameFilter(n, d->node, frameCtx);
+        for (int i = std::max(n - d->radius, 0); i <= std::min(n + d->radius, numFrames - 1); i++)
+            vsapi->requestFrameFilter(i, node, frameCtx);
     } else if (activationReason == arAllFramesReady) {
-        try {
-            auto threadId = std::this_thread::get_id();
+        const VSFrame * frames[15];
+        for (int i = 0; i < 2 * d->radius + 1; i++)
+            frames[i] = vsapi->getFrameFilter(std::min(std::max(n - d->radius + i, 0), numFrames - 1), node, frameCtx);
+
+        const VSFrame * src = frames[d->radius];
+        auto freeNeighbours = [&]() {
+            for (int i = 0; i < 2 * d->radius + 1; i++) {
+                if (i != d->radius)
+                    vsapi->freeFrame(frames[i]);
+            }
+        };
+
+        const DCTFilterData * op = d;
+        bool identity = d->identity;
+
+        if (!d->strength.empty()) {
+            const VSMap * props = vsapi->getFramePropertiesRO(src);
+            const char type = vsapi->mapGetType(props, d->strength.c_str());
+
+            if (type != ptInt && type != ptFloat) {
+                vsapi->setFilterError(("DCTFilter: frame property " + d->strength + " must be a number").c_str(), frameCtx);
+                freeNeighbours();
+                vsapi->freeFrame(src);
+                return nullptr;
+            }
+
+            const double strength = type == ptInt ? vsapi->mapGetInt(props, d->strength.c_str(), 0, nullptr)
+                                                  : vsapi->mapGetFloat(props, d->strength.c_str(), 0, nullptr);
+            const int step = strength > 0. ? static_cast<int>(std::lround(std::min(strength, 1.) * 64.)) : 0;
+
+            // Strength 0 leaves the pixels as they are. Coefficients still go through the transforms, with every weight 1, and the energy and
+            // stats are still reported.
+            if (!step && !d->mode && !d->energy && !d->stats) {
+                freeNeighbours();
+                return src;
+            }
+
+            identity |= !step && !d->mode;
+            op = acquireStrength(d, step);
+        }
+
+        VSFrame * dst;
+        const bool inplace = d->inplace && !identity;
 
-            if (!d->buffer.count(threadId)) {
-                float * buffer = fftwf_alloc_real(64);
-                if (!buffer)
-                    throw std::string{ "malloc failure (buffer)" };
-                d->buffer.emplace(threadId, buffer);
+        if (identity) {
+            // Only the properties are written.
+            dst = vsapi->copyFrame(src, core);
+        } else if (inplace) {
+            // A copy shares the planes with src until they are written. Once src is released, taking the write pointers is free if nobody
+            // else holds the frame, and duplicates the planes otherwise; from then on the copy is read and written in place.
+            dst = vsapi->copyFrame(src, core);
+            vsapi->freeFrame(src);
+
+            for (int plane = 0; plane < d->vi->format.numPlanes; plane++) {
+                if (d->process[plane])
+                    vsapi->getWritePtr(dst, plane);
+            }
+
+            src = frames[d->radius] = dst;
+        } else {
+            const VSFrame * fr[] = { d->process[0] ? nullptr : src, d->process[1] ? nullptr : src, d->process[2] ? nullptr : src };
+            const int pl[] = { 0, 1, 2 };
+            dst = vsapi->newVideoFrame2(&d->outputInfo.format, d->outputInfo.width, d->outputInfo.height, fr, pl, src, core);
+        }
+
+        std::atomic<bool> failed{ false };
+        // Time spent on each plane, summed over every thread working on it.
+        std::atomic<int64_t> elapsed[3]{ { 0 }, { 0 }, { 0 } };
+        std::atomic<int64_t> skipped[3]{ { 0 }, { 0 }, { 0 } };
+        // Band energies of each plane, which every run of strips adds its own sums to once.
+        double energy[3][16] = {};
+        std::mutex energyMutex;
+
+        auto processStrips = [&](const int plane, const int firstStrip, const int lastStrip, DCTFilterSeam * above, DCTFilterSeam * below) {
+            if (identity && !d->energy)
+                return;
+
+            unsigned slot;
+            float * buffer = acquireBuffer(d, slot);
+            if (!buffer) {
+                failed = true;
+                return;
+            }
+
+            const auto start = std::chrono::steady_clock::now();
+
+            // The source strips are measured before they are filtered, which may overwrite them.
+            if (d->energy) {
+                double sums[16] = {};
+                d->measurePlane(src, plane, firstStrip, lastStrip, buffer, sums, d, vsapi);
+
+                std::lock_guard<std::mutex> lock{ energyMutex };
+                for (int i = 0; i < d->size; i++)
+                    energy[plane][i] += sums[i];
+            }
+
+            if (!identity)
+                skipped[plane] += op->processPlane(frames, dst, plane, firstStrip, lastStrip, buffer, above, below, op, vsapi);
+
+            elapsed[plane] += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+            releaseBuffer(d, buffer, slot);
+        };
+
+        if (d->threads > 1) {
+            const auto & tasks = d->tasks;
+
+            // With overlap, seam i lies between tasks i and i + 1 of the same plane, so the blocks straddling it are transformed only once.
+            unsigned set = 0;
+            DCTFilterSeam * seams = d->seamSets && !identity ? acquireSeams(d, set) : nullptr;
+            if (d->seamSets && !identity && !seams)
+                failed = true;
+
+            auto seamBelow = [&](const unsigned i) -> DCTFilterSeam * {
+                return seams && i + 1 < tasks.size() && tasks[i + 1].plane == tasks[i].plane ? &seams[i] : nullptr;
+            };
+
+            ThreadPool * pool = d->pools[d->pools.size() > 1 ? getCurrentNode() : 0];
+
+            if (!failed) {
+                pool->run(static_cast<unsigned>(tasks.size()), d->threads - 1, [&](const unsigned i) {
+                    processStrips(tasks[i].plane, tasks[i].firstStrip, tasks[i].lastStrip, i ? seamBelow(i - 1) : nullptr, seamBelow(i));
+                });
+            }
+
+            if (seams)
+                releaseSeams(d, set);
+        } else {
+            for (int plane = 0; plane < d->vi->format.numPlanes; plane++) {
+                if (d->process[plane])
+                    processStrips(plane, 0, (vsapi->getFrameHeight(dst, plane) + d->size - 1) / d->size, nullptr, nullptr);
             }
-        } catch (const std::string & error) {
-            vsapi->setFilterError(("DCTFilter: " + error).c_str(), frameCtx);
+        }
+
+        if (failed) {
+            vsapi->setFilterError("DCTFilter: malloc failure (buffer)", frameCtx);
+            freeNeighbours();
+            if (!inplace)
+                vsapi->freeFrame(src);
+            vsapi->freeFrame(dst);
             return nullptr;
         }
 
-        const VSFrameRef * src = vsapi->getFrameFilter(n, d->node, frameCtx);
-        const VSFrameRef * fr[] = { d->process[0] ? nullptr : src, d->process[1] ? nullptr : src, d->process[2] ? nullptr : src };
-        const int pl[] = { 0, 1, 2 };
-        VSFrameRef * dst = vsapi->newVideoFrame2(d->vi->format, d->vi->width, d->vi->height, fr, pl, src, core);
+        int64_t time[3], blocks[3];
 
-        if (d->vi->format->bytesPerSample == 1)
-            process<uint8_t>(src, dst, d, vsapi);
-        else if (d->vi->format->bytesPerSample == 2)
-            process<uint16_t>(src, dst, d, vsapi);
-        else
-            process<float>(src, dst, d, vsapi);
+        for (int plane = 0; plane < d->vi->format.numPlanes; plane++) {
+            time[plane] = elapsed[plane];
+            blocks[plane] = d->process[plane] && !identity ? d->blocks[plane] - skipped[plane] : 0;
+            totalTime += time[plane];
+            totalBlocks += blocks[plane];
+        }
+
+        totalFrames++;
+        (*op->backendFrames)++;
+
+        if (d->stats) {
+            VSMap * props = vsapi->getFramePropertiesRW(dst);
+            vsapi->mapSetIntArray(props, "_DCTFilterTimeNs", time, d->vi->format.numPlanes);
+            vsapi->mapSetIntArray(props, "_DCTFilterBlocks", blocks, d->vi->format.numPlanes);
+            vsapi->mapSetData(props, "_DCTFilterBackend", op->backend.c_str(), -1, dtUtf8, maReplace);
+        }
+
+        if (d->energy) {
+            double bands[48] = {};
+
+            for (int plane = 0; plane < d->vi->format.numPlanes; plane++) {
+                const double count = static_cast<double>((vsapi->getFrameWidth(src, plane) + d->size - 1) / d->size) *
+                                     ((vsapi->getFrameHeight(src, plane) + d->size - 1) / d->size);
 
-        vsapi->freeFrame(src);
+                for (int i = 0; i < d->size; i++)
+                    bands[d->size * plane + i] = energy[plane][i] / count;
+            }
+
+            vsapi->mapSetFloatArray(vsapi->getFramePropertiesRW(dst), "_DCTFilterEnergy", bands, d->size * d->vi->format.numPlanes);
+        }
+
+        freeNeighbours();
+        if (!inplace)
+            vsapi->freeFrame(src);
         return dst;
     }
 
     return nullptr;
 }
 
-static void VS_CC dctfilterFree(void *instanceData, VSCore *core, const VSAPI *vsapi) {
+static const VSFrame *VS_CC dctfilterGetFrame(int n, int activationReason, void *instanceData, void **frameData, VSFrameContext *frameCtx, VSCore *core, const VSAPI *vsapi) {
     DCTFilterData * d = static_cast<DCTFilterData *>(instanceData);
+    return filterFrame(n, activationReason, d, d->node, frameCtx, core, vsapi);
+}
+
+static const VSFrame *VS_CC dctfilterMultiGetFrame(int n, int activationReason, void *instanceData, void **frameData, VSFrameContext *frameCtx, VSCore *core, const VSAPI *vsapi) {
+    DCTFilterClip * c = static_cast<DCTFilterClip *>(instanceData);
+    return filterFrame(n, activationReason, c->d.get(), c->node, frameCtx, core, vsapi);
+}
 
+static void destroy(DCTFilterData * d, const VSAPI * vsapi) {
     vsapi->freeNode(d->node);
 
-    fftwf_destroy_plan(d->dct);
-    fftwf_destroy_plan(d->idct);
+    releasePlans(d);
 
-    for (auto & iter : d->buffer)
-        fftwf_free(iter.second);
+    for (unsigned i = 0; i < d->slots; i++)
+        fftwf_free(d->buffer[i]);
+
+    for (unsigned i = 0; i < d->seamSets; i++)
+        fftwf_free(d->seamRows[i]);
+
+    if (!d->pools.empty())
+        releasePools();
+
+    for (int i = 0; i < 64; i++)
+        delete d->strengths[i].load(std::memory_order_relaxed);
 
     delete d;
 }
 
-static void VS_CC dctfilterCreate(const VSMap *in, VSMap *out, void *userData, VSCore *core, const VSAPI *vsapi) {
-    std::unique_ptr<DCTFilterData> d{ new DCTFilterData{} };
+static void VS_CC dctfilterFree(void *instanceData, VSCore *core, const VSAPI *vsapi) {
+    destroy(static_cast<DCTFilterData *>(instanceData), vsapi);
+}
 
-    d->node = vsapi->propGetNode(in, "clip", 0, nullptr);
-    d->vi = vsapi->getVideoInfo(d->node);
+static void VS_CC dctfilterMultiFree(void *instanceData, VSCore *core, const VSAPI *vsapi) {
+    DCTFilterClip * c = static_cast<DCTFilterClip *>(instanceData);
+    vsapi->freeNode(c->node);
+    delete c;
+}
 
-    const int padWidth = (d->vi->width & 15) ? 16 - d->vi->width % 16 : 0;
-    const int padHeight = (d->vi->height & 15) ? 16 - d->vi->height % 16 : 0;
+// Parses every argument but the clips and builds the operators, plans and buffers for clips of d->vi. Returns false before allocating
+// anything when every factor is 1: the round trip would only add rounding noise, so the clips are passed through instead, or only have
+// their energy measured and their stats reported.
+static bool initialize(DCTFilterData * d, const VSMap * in, VSCore * core, const VSAPI * vsapi) {
+    if (!vsh::isConstantVideoFormat(d->vi) || (d->vi->format.sampleType == stInteger && d->vi->format.bitsPerSample > 16) ||
+        (d->vi->format.sampleType == stFloat && d->vi->format.bitsPerSample != 16 && d->vi->format.bitsPerSample != 32))
+        throw std::string{ "only constant format 8-16 bit integer and 16/32 bit float input supported" };
 
-    try {
-        if (!isConstantFormat(d->vi) || (d->vi->format->sampleType == stInteger && d->vi->format->bitsPerSample > 16) ||
-            (d->vi->format->sampleType == stFloat && d->vi->format->bitsPerSample != 32))
-            throw std::string{ "only constant format 8-16 bit integer and 32 bit float input supported" };
+    const int m = vsapi->mapNumElements(in, "planes");
 
-        const double * factors = vsapi->propGetFloatArray(in, "factors", nullptr);
+    for (int i = 0; i < 3; i++)
+        d->process[i] = (m <= 0);
 
-        const int m = vsapi->propNumElements(in, "planes");
+    for (int i = 0; i < m; i++) {
+        const int n = vsapi->mapGetIntSaturated(in, "planes", i, nullptr);
 
-        for (int i = 0; i < 3; i++)
-            d->process[i] = (m <= 0);
+        if (n < 0 || n >= d->vi->format.numPlanes)
+            throw std::string{ "plane index out of range" };
 
-        for (int i = 0; i < m; i++) {
-            const int n = int64ToIntS(vsapi->propGetInt(in, "planes", i, nullptr));
+        if (d->process[n])
+            throw std::string{ "plane specified twice" };
 
-            if (n < 0 || n >= d->vi->format->numPlanes)
-                throw std::string{ "plane index out of range" };
+        d->process[n] = true;
+    }
 
-            if (d->process[n])
-                throw std::string{ "plane specified twice" };
+    int err;
+    d->size = vsapi->mapGetIntSaturated(in, "blocksize", 0, &err);
+    if (err)
+        d->size = 8;
 
-            d->process[n] = true;
-        }
+    if (d->size != 4 && d->size != 8 && d->size != 16)
+        throw std::string{ "blocksize must be 4, 8 or 16" };
+
+    const int size = d->size;
+    const int coefficients = size * size;
+
+    const char * output = vsapi->mapGetData(in, "output", 0, &err);
+
+    if (!err) {
+        if (!std::strcmp(output, "coeffs"))
+            d->mode = 1;
+        else if (std::strcmp(output, "pixels"))
+            throw std::string{ "output must be \"pixels\" or \"coeffs\"" };
+    }
 
-        if (vsapi->propNumElements(in, "factors") != 8)
-            throw std::string{ "the number of factors must be 8" };
+    // Coefficient planes hold whole blocks, the subsampled ones included.
+    auto pad = [size](const int length, const int subSampling) {
+        const int align = size << subSampling;
+        return (length + align - 1) / align * align;
+    };
 
-        for (int i = 0; i < 8; i++) {
+    if (d->mode == 2) {
+        if (pad(d->outputInfo.width, d->vi->format.subSamplingW) != d->vi->width || pad(d->outputInfo.height, d->vi->format.subSamplingH) != d->vi->height)
+            throw std::string{ "width and height must be those of the clip the coefficients were taken from" };
+    } else {
+        d->outputInfo = *d->vi;
+    }
+
+    if (d->mode == 1) {
+        vsapi->queryVideoFormat(&d->outputInfo.format, d->vi->format.colorFamily, stFloat, 32, d->vi->format.subSamplingW, d->vi->format.subSamplingH,
+                                core);
+        d->outputInfo.width = pad(d->vi->width, d->vi->format.subSamplingW);
+        d->outputInfo.height = pad(d->vi->height, d->vi->format.subSamplingH);
+    }
+
+    if (d->mode && std::count(d->process, d->process + d->vi->format.numPlanes, false))
+        throw std::string{ "output=\"coeffs\" requires every plane to be processed" };
+
+    // DCTFilterInverse takes no factors, they were applied along with the forward transform.
+    if (d->mode == 2) {
+        std::fill_n(d->requested, size, 1.);
+        d->numRequested = size;
+    } else {
+        const double * factors = vsapi->mapGetFloatArray(in, "factors", nullptr);
+        const int numFactors = vsapi->mapNumElements(in, "factors");
+
+        if (numFactors != size && numFactors != coefficients)
+            throw std::string{ "the number of factors must be " + std::to_string(size) + " or " + std::to_string(coefficients) };
+
+        for (int i = 0; i < numFactors; i++) {
             if (factors[i] < 0. || factors[i] > 1.)
                 throw std::string{ "factor must be between 0.0 and 1.0 (inclusive)" };
         }
 
-        const unsigned numThreads = vsapi->getCoreInfo(core)->numThreads;
-        d->buffer.reserve(numThreads);
+        const bool zigzag = !!vsapi->mapGetInt(in, "zigzag", 0, &err);
 
-        if (d->vi->format->sampleType == stInteger)
-            d->peak = (1 << d->vi->format->bitsPerSample) - 1;
+        if (zigzag && numFactors != coefficients)
+            throw std::string{ "zigzag requires " + std::to_string(coefficients) + " factors" };
 
-        if (padWidth || padHeight) {
-            VSMap * args = vsapi->createMap();
-            vsapi->propSetNode(args, "clip", d->node, paReplace);
-            vsapi->freeNode(d->node);
-            vsapi->propSetInt(args, "width", d->vi->width + padWidth, paReplace);
-            vsapi->propSetInt(args, "height", d->vi->height + padHeight, paReplace);
-            vsapi->propSetFloat(args, "src_width", d->vi->width + padWidth, paReplace);
-            vsapi->propSetFloat(args, "src_height", d->vi->height + padHeight, paReplace);
-
-            VSMap * ret = vsapi->invoke(vsapi->getPluginById("com.vapoursynth.resize", core), "Point", args);
-            if (vsapi->getError(ret)) {
-                vsapi->setError(out, vsapi->getError(ret));
-                vsapi->freeMap(args);
-                vsapi->freeMap(ret);
-                return;
-            }
+        int order[256];
+        zigzagOrder(size, order);
+
+        for (int i = 0; i < numFactors; i++)
+            d->requested[zigzag ? order[i] : i] = factors[i];
+
+        d->numRequested = numFactors;
+    }
+
+    double weights[256];
+    expandWeights(d, 1., weights);
+
+    d->radius = vsapi->mapGetIntSaturated(in, "radius", 0, &err);
+
+    if (d->radius < 0 || d->radius > 7)
+        throw std::string{ "radius must be between 0 and 7 (inclusive)" };
 
-            d->node = vsapi->propGetNode(ret, "clip", 0, nullptr);
-            d->vi = vsapi->getVideoInfo(d->node);
-            vsapi->freeMap(args);
-            vsapi->freeMap(ret);
+    if (d->radius) {
+        const double * factors = vsapi->mapGetFloatArray(in, "tfactors", &err);
+        const int numFactors = vsapi->mapNumElements(in, "tfactors");
+
+        if (numFactors != 2 * d->radius + 1)
+            throw std::string{ "radius " + std::to_string(d->radius) + " requires " + std::to_string(2 * d->radius + 1) + " tfactors" };
+
+        for (int i = 0; i < numFactors; i++) {
+            if (factors[i] < 0. || factors[i] > 1.)
+                throw std::string{ "tfactor must be between 0.0 and 1.0 (inclusive)" };
+
+            d->temporalRequested[i] = factors[i];
         }
 
-        for (int y = 0; y < 8; y++) {
-            for (int x = 0; x < 8; x++)
-                d->factors[8 * y + x] = static_cast<float>(factors[y] * factors[x]);
+        if (d->mode)
+            throw std::string{ "radius requires output=\"pixels\"" };
+    } else {
+        if (vsapi->mapNumElements(in, "tfactors") > 0)
+            throw std::string{ "tfactors requires a radius" };
+
+        d->temporalRequested[0] = 1.;
+    }
+
+    blendWeights(d, 1., d->temporal);
+
+    d->overlap = vsapi->mapGetIntSaturated(in, "overlap", 0, &err);
+    if (err)
+        d->overlap = 1;
+
+    if (d->overlap != 1 && d->overlap != 2 && d->overlap != 4)
+        throw std::string{ "overlap must be 1, 2 or 4" };
+
+    // Two grids are offset diagonally by half a block, four take every combination of a vertical and horizontal half-block offset.
+    for (int i = 1; i < d->overlap; i++) {
+        d->shifts[i][0] = (d->overlap == 2 || i >= 2) ? size / 2 : 0;
+        d->shifts[i][1] = (d->overlap == 2 || (i & 1)) ? size / 2 : 0;
+    }
+
+    if (d->mode && d->overlap > 1)
+        throw std::string{ "output=\"coeffs\" requires overlap 1" };
+
+    // The output decides which blocks there are: in the coefficient modes that is every block of the coefficient planes.
+    for (int plane = 0; plane < d->vi->format.numPlanes; plane++) {
+        const int width = d->outputInfo.width >> (plane ? d->vi->format.subSamplingW : 0);
+        const int height = d->outputInfo.height >> (plane ? d->vi->format.subSamplingH : 0);
+
+        for (int i = 0; i < d->overlap; i++)
+            d->blocks[plane] += static_cast<int64_t>((width + d->shifts[i][1] + size - 1) / size) * ((height + d->shifts[i][0] + size - 1) / size);
+    }
+
+    const int opt = vsapi->mapGetIntSaturated(in, "opt", 0, &err);
+
+    if (opt < 0 || opt > 4)
+        throw std::string{ "opt must be 0, 1, 2, 3, or 4" };
+
+    int iset = 0;
+#ifdef DCTFILTER_X86
+    iset = getInstructionSet();
+#elif defined(DCTFILTER_ARM)
+    iset = 2;
+#endif
+
+    if (opt > 1 && opt > iset)
+        throw std::string{ "the requested instruction set is not supported on this CPU" };
+
+    const bool fixed = !!vsapi->mapGetInt(in, "fixed", 0, &err);
+
+    d->stats = !!vsapi->mapGetInt(in, "stats", 0, &err);
+
+    d->energy = !!vsapi->mapGetInt(in, "energy", 0, &err);
+
+    if (d->energy && d->mode)
+        throw std::string{ "energy requires output=\"pixels\"" };
+
+    const char * strength = vsapi->mapGetData(in, "strength", 0, &err);
+    if (!err && *strength)
+        d->strength = strength;
+
+    // Scaling a separable matrix towards 1 element by element does not keep it separable.
+    if (fixed && !d->strength.empty() && d->numRequested != size)
+        throw std::string{ "fixed with strength requires " + std::to_string(size) + " factors" };
+
+    if (fixed) {
+        if (d->mode)
+            throw std::string{ "fixed requires output=\"pixels\"" };
+
+        if (d->vi->format.sampleType != stInteger || d->vi->format.bitsPerSample > 10)
+            throw std::string{ "fixed requires 8-10 bit integer input" };
+
+        if (size != 8 || d->overlap > 1)
+            throw std::string{ "fixed requires blocksize 8 without overlap" };
+
+        if (d->radius)
+            throw std::string{ "fixed requires radius 0" };
+
+        if (opt == 1 || iset < 2)
+            throw std::string{ "fixed requires one of the SIMD implementations" };
+    }
+
+    d->flat = static_cast<float>(vsapi->mapGetFloat(in, "flat", 0, &err));
+
+    if (d->flat < 0.f)
+        throw std::string{ "flat must be greater than or equal to 0.0" };
+
+    if (d->flat > 0.f) {
+        if (d->mode)
+            throw std::string{ "flat requires output=\"pixels\"" };
+
+        // The batched FFTW plans only take whole strips.
+        if (opt == 1 || iset < 2)
+            throw std::string{ "flat requires one of the SIMD implementations" };
+    }
+
+    d->inplace = !!vsapi->mapGetInt(in, "inplace", 0, &err);
+
+    // Every other path reads pixels of neighbouring strips or frames, or writes another format.
+    if (d->inplace && (d->mode || d->overlap > 1 || d->radius))
+        throw std::string{ "inplace requires output=\"pixels\", overlap 1 and radius 0" };
+
+    const char * planner = vsapi->mapGetData(in, "planner", 0, &err);
+    unsigned plannerFlags = FFTW_PATIENT;
+
+    if (!err) {
+        if (!std::strcmp(planner, "estimate"))
+            plannerFlags = FFTW_ESTIMATE;
+        else if (!std::strcmp(planner, "measure"))
+            plannerFlags = FFTW_MEASURE;
+        else if (std::strcmp(planner, "patient"))
+            throw std::string{ "planner must be \"estimate\", \"measure\" or \"patient\"" };
+    }
+
+    const char * wisdom = vsapi->mapGetData(in, "wisdom", 0, &err);
+    if (err || !*wisdom)
+        wisdom = nullptr;
+
+    VSCoreInfo info;
+    vsapi->getCoreInfo(core, &info);
+    const unsigned numThreads = info.numThreads;
+    int threads = vsapi->mapGetIntSaturated(in, "threads", 0, &err);
+    if (err)
+        threads = 1;
+
+    if (threads < 0)
+        throw std::string{ "threads must be greater than or equal to 0" };
+
+    // Never split a frame across more threads than the core itself runs.
+    d->threads = threads ? std::min(static_cast<unsigned>(threads), numThreads) : numThreads;
+
+    // The pixel side decides the peak, which is the output in DCTFilterInverse.
+    const VSVideoFormat & pixels = d->mode == 2 ? d->outputInfo.format : d->vi->format;
+
+    if (pixels.sampleType == stInteger)
+        d->peak = (1 << pixels.bitsPerSample) - 1;
+
+    // With energy or stats the frames are still measured and counted, only copied instead of filtered.
+    d->identity = !d->mode && std::all_of(weights, weights + coefficients, [](const double weight) { return weight == 1.; }) &&
+                  std::all_of(d->temporalRequested, d->temporalRequested + 2 * d->radius + 1, [](const double factor) { return factor == 1.; });
+
+    if (d->identity && !d->energy && !d->stats)
+        return false;
+
+    // Only then does a constant block come out of the transforms as it went in.
+    if (d->flat > 0.f && weights[0] != 1.)
+        throw std::string{ "flat requires a DC factor of 1.0" };
+
+    if (size == 4)
+        selectProcess<4>(d);
+    else if (size == 8)
+        selectProcess<8>(d);
+    else
+        selectProcess<16>(d);
+
+    d->level = (opt == 1 || (opt == 0 && iset < 2)) ? 1 : opt ? opt : iset;
+    d->fixed = fixed;
+    prepare(d, weights);
+
+    if (d->energy) {
+        int order[256];
+        zigzagOrder(size, order);
+
+        // The square of the orthonormal scale of the unnormalized DCT, per dimension 1 / (4 * size) for DC and 1 / (2 * size) otherwise.
+        for (int i = 0; i < coefficients; i++) {
+            d->bands[order[i]] = i / size;
+            d->energyScale[i] = 1.f / ((i / size ? 2 : 4) * size) / ((i % size ? 2 : 4) * size);
         }
 
-        float * buffer = fftwf_alloc_real(64);
+        if (d->level == 1)
+            d->analyze = analyzeFFTW;
+        else if (size == 4)
+            selectAnalyze<4>(d, d->level);
+        else if (size == 8)
+            selectAnalyze<8>(d, d->level);
+        else
+            selectAnalyze<16>(d, d->level);
+    }
+
+    // Horizontally shifted grids start half a block left of the plane and need one more block per strip.
+    const unsigned maxBlocks = (d->outputInfo.width + (d->overlap > 1 ? size / 2 : 0) + size - 1) / size;
+
+    // Half precision pixels are converted through floats staged next to the tile.
+    const bool half = pixels.sampleType == stFloat && pixels.bytesPerSample == 2;
+    d->loadHalf = loadHalfC;
+    d->storeHalf = storeHalfC;
+#ifdef DCTFILTER_X86
+    if (d->level >= 3 && hasF16C()) {
+        d->loadHalf = load_f16c;
+        d->storeHalf = store_f16c;
+    }
+#elif defined(DCTFILTER_ARM) && defined(__aarch64__)
+    if (d->level >= 2) {
+        d->loadHalf = load_neon;
+        d->storeHalf = store_neon;
+    }
+#endif
+
+    // A tile's coefficients plus its source and output pixels take at most half of the L1 data cache, assumed to be 32 KiB when unknown. Only
+    // L1 is detected: the overlap accumulator and the source rows of a strip span the whole width whatever the tile, so L2 bounds nothing.
+    static const unsigned cacheSize = getDataCacheSize();
+    const unsigned blockBytes = coefficients * ((fixed ? 2 : 4) + 2 * d->vi->format.bytesPerSample + (half ? 4 : 0));
+    d->tileBlocks = static_cast<int>(d->level == 1 ? maxBlocks : std::max((cacheSize ? cacheSize : 32768) / 2 / blockBytes, 1u));
+
+    if (d->level == 1) {
+        float * buffer = fftwf_alloc_real(coefficients * maxBlocks);
         if (!buffer)
             throw std::string{ "malloc failure (buffer)" };
 
-        d->dct = fftwf_plan_r2r_2d(8, 8, buffer, buffer, FFTW_REDFT10, FFTW_REDFT10, FFTW_PATIENT);
-        d->idct = fftwf_plan_r2r_2d(8, 8, buffer, buffer, FFTW_REDFT01, FFTW_REDFT01, FFTW_PATIENT);
+        std::lock_guard<std::mutex> lock{ plannerMutex };
+
+        if (wisdom && !importedWisdom.count(wisdom)) {
+            fftwf_import_wisdom_from_filename(wisdom);
+            importedWisdom.emplace(wisdom);
+        }
+
+        bool created = false;
+        int plans = 0;
+
+        try {
+            for (int plane = 0; plane < d->vi->format.numPlanes; plane++) {
+                if (!d->process[plane])
+                    continue;
+
+                const unsigned width = d->outputInfo.width >> (plane ? d->vi->format.subSamplingW : 0);
+
+                for (const unsigned blocks : { (width + size - 1) / size, d->overlap > 1 ? (width + size / 2 + size - 1) / size : 0 }) {
+                    if (!blocks || std::count(d->fftwBlocks, d->fftwBlocks + plans, blocks))
+                        continue;
+
+                    d->fftwBlocks[plans] = blocks;
+                    d->dct[plans] = acquirePlan(size, blocks, false, plannerFlags, buffer, created);
+                    d->idct[plans] = acquirePlan(size, blocks, true, plannerFlags, buffer, created);
+                    plans++;
+                }
+            }
+        } catch (const std::string &) {
+            fftwf_free(buffer);
+            throw;
+        }
 
         fftwf_free(buffer);
+
+        if (wisdom && created && !fftwf_export_wisdom_to_filename(wisdom))
+            vsapi->logMessage(mtWarning, ("DCTFilter: failed to export FFTW wisdom to " + std::string{ wisdom }).c_str(), core);
+
+    }
+
+    if (d->threads > 1) {
+        d->pools = acquirePools();
+
+        int strips[3] = {}, widths[3] = {};
+        int64_t totalWork = 0;
+
+        // A strip's cost is proportional to the plane's width, so subsampled chroma strips only count for a fraction of a luma one.
+        for (int plane = 0; plane < d->vi->format.numPlanes; plane++) {
+            if (d->process[plane]) {
+                strips[plane] = ((d->outputInfo.height >> (plane ? d->vi->format.subSamplingH : 0)) + size - 1) / size;
+                widths[plane] = d->outputInfo.width >> (plane ? d->vi->format.subSamplingW : 0);
+                totalWork += static_cast<int64_t>(strips[plane]) * widths[plane];
+            }
+        }
+
+        // A few equally expensive chunks per thread keeps the tail short when some threads are also busy with other frames, and whichever
+        // plane a thread ends up on it finishes at about the same time as the others.
+        const int64_t chunkWork = std::max<int64_t>(totalWork / (d->threads * 4), 1);
+
+        for (int plane = 0; plane < d->vi->format.numPlanes; plane++) {
+            if (d->process[plane]) {
+                const int chunk = static_cast<int>(std::max<int64_t>(chunkWork / widths[plane], 1));
+
+                for (int i = 0; i < strips[plane]; i += chunk)
+                    d->tasks.push_back({ plane, i, std::min(i + chunk, strips[plane]), widths[plane] });
+            }
+        }
+
+        // Each seam holds both runs' sums of the size rows around it.
+        if (d->overlap > 1) {
+            for (size_t i = 0; i + 1 < d->tasks.size(); i++)
+                d->seamSize += d->tasks[i + 1].plane == d->tasks[i].plane ? size * d->tasks[i].width : 0;
+
+            d->seamSets = numThreads;
+            d->seams.reset(new DCTFilterSeam[d->tasks.size() * numThreads]);
+            d->seamRows.reset(new float *[numThreads]());
+            d->seamsBusy.reset(new std::atomic<bool>[numThreads]());
+        }
+    }
+
+    // Every frame in flight holds a buffer, and so does every helper working on one. Each frame draws up to threads - 1 helpers from a
+    // pool that all frames share, so the helpers are bounded by both the pool's size and the frames in flight times threads - 1. With
+    // NUMA the frames may all run on one node and draw from its pool alone, so every node gets slots for all of them and for the largest
+    // of the per-node pools.
+    unsigned helpers = 0;
+    for (const auto pool : d->pools)
+        helpers = std::max(helpers, std::min(pool->size(), numThreads * (d->threads - 1)));
+    d->nodes = std::max(static_cast<unsigned>(getNumaTopology().cpus.size()), 1u);
+    const unsigned numSlots = (numThreads + helpers) * d->nodes;
+    d->halfOffset = coefficients * maxBlocks + (d->overlap > 1 ? (size + size / 2) * d->outputInfo.width : 0);
+    d->bufferSize = d->halfOffset + (half ? (2 * d->radius + 1) * coefficients * std::min(static_cast<unsigned>(d->tileBlocks), maxBlocks) : 0);
+    d->buffer.reset(new float *[numSlots]());
+    d->busy.reset(new std::atomic<bool>[numSlots]());
+
+    if (d->nodes > 1)
+        d->slots = numSlots;
+
+    for (; d->slots < numSlots; d->slots++) {
+        d->buffer[d->slots] = fftwf_alloc_real(d->bufferSize);
+        if (!d->buffer[d->slots]) {
+            for (unsigned i = 0; i < d->slots; i++)
+                fftwf_free(d->buffer[i]);
+            if (!d->pools.empty())
+                releasePools();
+            throw std::string{ "malloc failure (buffer)" };
+        }
+    }
+
+    d->strengths[64] = d;
+    return true;
+}
+
+static void VS_CC dctfilterCreate(const VSMap *in, VSMap *out, void *userData, VSCore *core, const VSAPI *vsapi) {
+    std::unique_ptr<DCTFilterData> d{ new DCTFilterData{} };
+
+    d->node = vsapi->mapGetNode(in, "clip", 0, nullptr);
+    d->vi = vsapi->getVideoInfo(d->node);
+
+    try {
+        if (!initialize(d.get(), in, core, vsapi)) {
+            vsapi->mapSetNode(out, "clip", d->node, maReplace);
+            vsapi->freeNode(d->node);
+            return;
+        }
     } catch (const std::string & error) {
-        vsapi->setError(out, ("DCTFilter: " + error).c_str());
+        vsapi->mapSetError(out, ("DCTFilter: " + error).c_str());
         vsapi->freeNode(d->node);
+        releasePlans(d.get());
         return;
     }
 
-    vsapi->createFilter(in, out, "DCTFilter", dctfilterInit, dctfilterGetFrame, dctfilterFree, fmParallel, 0, d.release(), core);
+    // Without a radius output frame n only needs source frame n, which lets the core skip caching what it has already handed out.
+    const VSFilterDependency deps[] = { { d->node, d->radius ? rpGeneral : rpStrictSpatial } };
+    const VSVideoInfo * vi = &d->outputInfo;
+    vsapi->createVideoFilter(out, "DCTFilter", vi, dctfilterGetFrame, dctfilterFree, fmParallel, deps, 1, d.release(), core);
+}
+
+static void VS_CC dctfilterMultiCreate(const VSMap *in, VSMap *out, void *userData, VSCore *core, const VSAPI *vsapi) {
+    std::unique_ptr<DCTFilterData> d{ new DCTFilterData{} };
+    std::vector<VSNode *> nodes(vsapi->mapNumElements(in, "clips"));
+
+    for (int i = 0; i < static_cast<int>(nodes.size()); i++)
+        nodes[i] = vsapi->mapGetNode(in, "clips", i, nullptr);
 
-    if (padWidth || padHeight) {
-        VSNodeRef * node = vsapi->propGetNode(out, "clip", 0, nullptr);
-        vsapi->clearMap(out);
+    // The context holds a reference of its own to the first clip, so vi stays valid for as long as any output does.
+    d->node = vsapi->addNodeRef(nodes[0]);
+    d->vi = vsapi->getVideoInfo(d->node);
+
+    try {
+        for (const auto node : nodes) {
+            const VSVideoInfo * vi = vsapi->getVideoInfo(node);
 
-        VSMap * args = vsapi->createMap();
-        vsapi->propSetNode(args, "clip", node, paReplace);
-        vsapi->freeNode(node);
-        vsapi->propSetInt(args, "right", padWidth, paReplace);
-        vsapi->propSetInt(args, "bottom", padHeight, paReplace);
+            // Plans, strip buffers and block counts all depend on the format and dimensions, the frame count does not.
+            if (!vsh::isSameVideoFormat(&vi->format, &d->vi->format) || vi->width != d->vi->width || vi->height != d->vi->height)
+                throw std::string{ "all clips must have the same format and dimensions" };
+        }
 
-        VSMap * ret = vsapi->invoke(vsapi->getPluginById("com.vapoursynth.std", core), "Crop", args);
-        if (vsapi->getError(ret)) {
-            vsapi->setError(out, vsapi->getError(ret));
-            vsapi->freeMap(args);
-            vsapi->freeMap(ret);
+        if (!initialize(d.get(), in, core, vsapi)) {
+            for (const auto node : nodes)
+                vsapi->mapConsumeNode(out, "clip", node, maAppend);
+            vsapi->freeNode(d->node);
             return;
         }
+    } catch (const std::string & error) {
+        vsapi->mapSetError(out, ("DCTFilterMulti: " + error).c_str());
+        for (const auto node : nodes)
+            vsapi->freeNode(node);
+        vsapi->freeNode(d->node);
+        releasePlans(d.get());
+        return;
+    }
+
+    const std::shared_ptr<DCTFilterData> context{ d.release(), [vsapi](DCTFilterData * p) { destroy(p, vsapi); } };
+
+    for (const auto node : nodes) {
+        const VSFilterDependency deps[] = { { node, context->radius ? rpGeneral : rpStrictSpatial } };
+        VSVideoInfo vi = context->outputInfo;
+        vi.numFrames = vsapi->getVideoInfo(node)->numFrames;
+
+        VSNode * output = vsapi->createVideoFilter2("DCTFilterMulti", &vi, dctfilterMultiGetFrame, dctfilterMultiFree, fmParallel, deps, 1,
+                                                    new DCTFilterClip{ context, node }, core);
+        vsapi->mapConsumeNode(out, "clip", output, maAppend);
+    }
+}
+
+static void VS_CC dctfilterInverseCreate(const VSMap *in, VSMap *out, void *userData, VSCore *core, const VSAPI *vsapi) {
+    std::unique_ptr<DCTFilterData> d{ new DCTFilterData{} };
+
+    d->node = vsapi->mapGetNode(in, "clip", 0, nullptr);
+    d->vi = vsapi->getVideoInfo(d->node);
+    d->mode = 2;
+
+    try {
+        if (!vsh::isConstantVideoFormat(d->vi) || d->vi->format.sampleType != stFloat || d->vi->format.bitsPerSample != 32)
+            throw std::string{ "only constant format 32 bit float coefficients supported" };
+
+        int err;
+        d->outputInfo = *d->vi;
+
+        const int format = vsapi->mapGetIntSaturated(in, "format", 0, &err);
+
+        if (!err) {
+            if (!vsapi->getVideoFormatByID(&d->outputInfo.format, format, core))
+                throw std::string{ "invalid format" };
+
+            const VSVideoFormat & f = d->outputInfo.format;
+
+            if (f.colorFamily != d->vi->format.colorFamily || f.subSamplingW != d->vi->format.subSamplingW || f.subSamplingH != d->vi->format.subSamplingH)
+                throw std::string{ "format must have the color family and subsampling of the coefficients" };
+
+            if ((f.sampleType == stInteger && f.bitsPerSample > 16) || (f.sampleType == stFloat && f.bitsPerSample != 16 && f.bitsPerSample != 32))
+                throw std::string{ "only 8-16 bit integer and 16/32 bit float output supported" };
+        }
+
+        d->outputInfo.width = vsapi->mapGetIntSaturated(in, "width", 0, &err);
+        if (err)
+            d->outputInfo.width = d->vi->width;
+
+        d->outputInfo.height = vsapi->mapGetIntSaturated(in, "height", 0, &err);
+        if (err)
+            d->outputInfo.height = d->vi->height;
+
+        if (d->outputInfo.width <= 0 || d->outputInfo.height <= 0)
+            throw std::string{ "width and height must be greater than 0" };
+
+        initialize(d.get(), in, core, vsapi);
+    } catch (const std::string & error) {
+        vsapi->mapSetError(out, ("DCTFilterInverse: " + error).c_str());
+        vsapi->freeNode(d->node);
+        releasePlans(d.get());
+        return;
+    }
+
+    const VSFilterDependency deps[] = { { d->node, rpStrictSpatial } };
+    const VSVideoInfo * vi = &d->outputInfo;
+    vsapi->createVideoFilter(out, "DCTFilterInverse", vi, dctfilterGetFrame, dctfilterFree, fmParallel, deps, 1, d.release(), core);
+}
+
+static void VS_CC dctfilterStats(const VSMap *in, VSMap *out, void *userData, VSCore *core, const VSAPI *vsapi) {
+    vsapi->mapSetInt(out, "frames", totalFrames, maReplace);
+    vsapi->mapSetInt(out, "blocks", totalBlocks, maReplace);
+    vsapi->mapSetInt(out, "time", totalTime, maReplace);
 
-        node = vsapi->propGetNode(ret, "clip", 0, nullptr);
-        vsapi->freeMap(args);
-        vsapi->freeMap(ret);
-        vsapi->propSetNode(out, "clip", node, paReplace);
-        vsapi->freeNode(node);
+    std::lock_guard<std::mutex> lock{ statsMutex };
+
+    for (const auto & backend : backendFrames) {
+        vsapi->mapSetData(out, "backends", backend.first.c_str(), -1, dtUtf8, maAppend);
+        vsapi->mapSetInt(out, "backend_frames", backend.second, maAppend);
     }
 }
 
 //////////////////////////////////////////
 // Init
 
-VS_EXTERNAL_API(void) VapourSynthPluginInit(VSConfigPlugin configFunc, VSRegisterFunction registerFunc, VSPlugin *plugin) {
-    configFunc("com.holywu.dctfilter", "dctf", "DCT/IDCT Frequency Suppressor", VAPOURSYNTH_API_VERSION, 1, plugin);
-    registerFunc("DCTFilter",
-                 "clip:clip;"
-                 "factors:float[];"
-                 "planes:int[]:opt;",
-                 dctfilterCreate, nullptr, plugin);
+// Every argument but the clips, which DCTFilter and DCTFilterMulti share.
+static const char * const filterArgs =
+    "factors:float[];"
+    "planes:int[]:opt;"
+    "zigzag:int:opt;"
+    "overlap:int:opt;"
+    "blocksize:int:opt;"
+    "fixed:int:opt;"
+    "flat:float:opt;"
+    "radius:int:opt;"
+    "tfactors:float[]:opt;"
+    "inplace:int:opt;"
+    "stats:int:opt;"
+    "energy:int:opt;"
+    "strength:data:opt;"
+    "output:data:opt;"
+    "opt:int:opt;"
+    "threads:int:opt;"
+    "planner:data:opt;"
+    "wisdom:data:opt;";
+
+VS_EXTERNAL_API(void) VapourSynthPluginInit2(VSPlugin *plugin, const VSPLUGINAPI *vspapi) {
+    vspapi->configPlugin("com.holywu.dctfilter", "dctf", "DCT/IDCT Frequency Suppressor", VS_MAKE_VERSION(2, 0), VAPOURSYNTH_API_VERSION, 0, plugin);
+    vspapi->registerFunction("DCTFilter", ("clip:vnode;" + std::string{ filterArgs }).c_str(), "clip:vnode;", dctfilterCreate, nullptr, plugin);
+    vspapi->registerFunction("DCTFilterMulti", ("clips:vnode[];" + std::string{ filterArgs }).c_str(), "clip:vnode[];", dctfilterMultiCreate, nullptr,
+                             plugin);
+    vspapi->registerFunction("DCTFilterInverse",
+                             "clip:vnode;"
+                             "blocksize:int:opt;"
+                             "width:int:opt;"
+                             "height:int:opt;"
+                             "format:int:opt;"
+                             "opt:int:opt;"
+                             "threads:int:opt;"
+                             "planner:data:opt;"
+                             "wisdom:data:opt;",
+                             "clip:vnode;", dctfilterInverseCreate, nullptr, plugin);
+    vspapi->registerFunction("Stats", "", "frames:int;blocks:int;time:int;backends:data[]:opt;backend_frames:int[]:opt;", dctfilterStats, nullptr, plugin);
 }
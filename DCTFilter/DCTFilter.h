@@ -0,0 +1,163 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <VapourSynth4.h>
+#include <VSHelper4.h>
+
+#include <fftw3.h>
+
+// VSHelper4.h no longer provides it.
+#ifndef VS_RESTRICT
+#define VS_RESTRICT __restrict
+#endif
+
+class ThreadPool;
+
+// Both runs' partial sums of the rows where two runs of strips meet, and how many of the runs are done with them.
+struct DCTFilterSeam {
+    float * rows[2];
+    std::atomic<int> arrivals{ 0 };
+};
+
+// A run of strips of one plane, handed to a single thread.
+struct DCTFilterTask {
+    int plane, firstStrip, lastStrip, width;
+};
+
+struct DCTFilterData {
+    VSNode * node;
+    const VSVideoInfo * vi;
+    bool process[3];
+    int peak;
+    // Width and height of the transform blocks.
+    int size;
+    // 0 filters pixels, 1 outputs weighted coefficients (output="coeffs"), 2 turns them back into pixels (DCTFilterInverse), and the output.
+    int mode;
+    VSVideoInfo outputInfo;
+    // Instruction set of the transform kernels, numbered like opt, and whether 8x8 blocks take the fixed-point path.
+    int level;
+    bool fixed;
+    // The factors as given, the row and column vector or the whole matrix in row-major order, from which per-frame weights are derived.
+    double requested[256];
+    int numRequested;
+    // Per-coefficient weights, including the 1 / (4 * size^2) gain of the unnormalized DCT/IDCT round trip.
+    float factors[256];
+    // Each matrix holds the size x size transform M in row-major order followed by its transpose.
+    float dctMatrix[512], idctMatrix[512];
+    // Vertical and horizontal IDCT * diag(weights) * DCT, applied on its own when the factors are separable.
+    float fusedMatrix[512];
+    // Q14 fixed-point fused operators for 8x8 blocks, the horizontal one interleaved by pairs of input columns, and the intermediate precision.
+    int16_t fixedHorizontal[64], fixedVertical[64];
+    int fixedShift;
+    // Frequency rows and columns holding at least one nonzero weight; the pruned kernels never touch the others.
+    int rows[16], columns[16];
+    int numRows, numColumns;
+    // Number of frames on either side of frame n, the temporal factors as given, and each frame's weight in the blend of frame n.
+    int radius;
+    double temporalRequested[15];
+    float temporal[15];
+    // Number of averaged block grids and each grid's vertical and horizontal offset.
+    int overlap;
+    int shifts[4][2];
+    // Batched FFTW plans transforming a whole strip of blocks, one pair per distinct strip length.
+    unsigned fftwBlocks[4];
+    fftwf_plan dct[4], idct[4];
+    // Largest difference between the samples of a block for which it counts as flat and is left as it is, or 0 to transform every block.
+    float flat;
+    // Number of blocks gathered, transformed and stored at a time, sized to the L1 data cache alone. FFTW always takes whole strips.
+    int tileBlocks;
+    void (*filter)(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d);
+    void (*fixedFilter)(int16_t * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d);
+    // Conversions of half precision rows to and from floats, and the offset into a strip buffer of the floats a tile's rows are staged in.
+    void (*loadHalf)(const uint16_t * VS_RESTRICT src, float * VS_RESTRICT dst, const unsigned n);
+    void (*storeHalf)(const float * VS_RESTRICT src, uint16_t * VS_RESTRICT dst, const unsigned n);
+    unsigned halfOffset;
+    // Filters strips of frames n - radius .. n + radius between two seams, if any, and returns the number of flat blocks left untransformed.
+    int64_t (*processPlane)(const VSFrame * const * src, VSFrame * dst, const int plane, const int firstStrip, const int lastStrip, float * VS_RESTRICT buffer,
+                         DCTFilterSeam * above, DCTFilterSeam * below, const DCTFilterData * d, const VSAPI * vsapi);
+    // Name of the selected implementation, its process-wide frame counter, and the number of blocks one frame transforms in each plane.
+    std::string backend;
+    std::atomic<int64_t> * backendFrames;
+    int64_t blocks[3];
+    // Whether frames are filtered in place on a copy-on-write copy of the source, and whether every factor is 1.
+    bool inplace, identity;
+    // Whether every output frame carries its timing and block counts as properties.
+    bool stats;
+    // Whether frames carry their band energies, each coefficient's zigzag band and squared orthonormal scale, and the measuring kernels.
+    bool energy;
+    int bands[256];
+    float energyScale[256];
+    void (*analyze)(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d);
+    void (*measurePlane)(const VSFrame * src, const int plane, const int firstStrip, const int lastStrip, float * VS_RESTRICT buffer, double * sums,
+                         const DCTFilterData * d, const VSAPI * vsapi);
+    // Frame property holding the strength, if any, and the operators built so far for each of its 65 steps, the last being this instance.
+    std::string strength;
+    std::atomic<DCTFilterData *> strengths[65];
+    std::mutex strengthMutex;
+    // Number of threads working on one frame, the calling worker included, and the helper pools, one per NUMA node.
+    unsigned threads;
+    std::vector<ThreadPool *> pools;
+    // Runs of strips each frame is split into, and for each frame in flight a set of seams between the runs, allocated on first use.
+    std::vector<DCTFilterTask> tasks;
+    unsigned seamSets, seamSize;
+    std::unique_ptr<DCTFilterSeam[]> seams;
+    std::unique_ptr<float *[]> seamRows;
+    std::unique_ptr<std::atomic<bool>[]> seamsBusy;
+    // Number of NUMA nodes, which own equal shares of the slots, and the strip buffers, each claimed by one run of strips at a time.
+    unsigned nodes, slots, bufferSize;
+    std::unique_ptr<float *[]> buffer;
+    std::unique_ptr<std::atomic<bool>[]> busy;
+};
+
+#ifdef DCTFILTER_X86
+template<int N, bool fused>
+extern void filter_sse2(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept;
+template<int N>
+extern void prune_sse2(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept;
+template<int N, bool inverse>
+extern void transform_sse2(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept;
+template<int N>
+extern void analyze_sse2(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept;
+extern void fixed_sse2(int16_t * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept;
+template<int N, bool fused>
+extern void filter_avx2(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept;
+template<int N>
+extern void prune_avx2(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept;
+template<int N, bool inverse>
+extern void transform_avx2(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept;
+template<int N>
+extern void analyze_avx2(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept;
+extern void fixed_avx2(int16_t * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept;
+extern void load_f16c(const uint16_t * VS_RESTRICT src, float * VS_RESTRICT dst, const unsigned n) noexcept;
+extern void store_f16c(const float * VS_RESTRICT src, uint16_t * VS_RESTRICT dst, const unsigned n) noexcept;
+template<int N, bool fused>
+extern void filter_avx512(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept;
+template<int N>
+extern void prune_avx512(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept;
+template<int N, bool inverse>
+extern void transform_avx512(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept;
+template<int N>
+extern void analyze_avx512(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept;
+#endif
+
+#ifdef DCTFILTER_ARM
+template<int N, bool fused>
+extern void filter_neon(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept;
+template<int N>
+extern void prune_neon(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept;
+template<int N, bool inverse>
+extern void transform_neon(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept;
+template<int N>
+extern void analyze_neon(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept;
+extern void fixed_neon(int16_t * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept;
+#ifdef __aarch64__
+extern void load_neon(const uint16_t * VS_RESTRICT src, float * VS_RESTRICT dst, const unsigned n) noexcept;
+extern void store_neon(const float * VS_RESTRICT src, uint16_t * VS_RESTRICT dst, const unsigned n) noexcept;
+#endif
+#endif
@@ -0,0 +1,181 @@
+/*
+    MIT License
+
+    Copyright (c) 2017 HolyWu
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#ifdef DCTFILTER_X86
+#include <cstring>
+#include <type_traits>
+
+#include <immintrin.h>
+
+#include "Transform.h"
+
+namespace {
+struct Xmm {
+    typedef __m128 type;
+    static constexpr int lanes = 4;
+
+    static inline __m128 zero() noexcept { return _mm_setzero_ps(); }
+    static inline __m128 load(const float * p) noexcept { return _mm_loadu_ps(p); }
+    static inline void store(float * p, const __m128 a) noexcept { _mm_storeu_ps(p, a); }
+    static inline __m128 broadcast(const float * p) noexcept { return _mm_broadcast_ss(p); }
+    static inline __m128 mul(const __m128 a, const __m128 b) noexcept { return _mm_mul_ps(a, b); }
+    static inline __m128 fmadd(const __m128 a, const __m128 b, const __m128 c) noexcept { return _mm_fmadd_ps(a, b, c); }
+};
+
+struct Ymm {
+    typedef __m256 type;
+    static constexpr int lanes = 8;
+
+    static inline __m256 zero() noexcept { return _mm256_setzero_ps(); }
+    static inline __m256 load(const float * p) noexcept { return _mm256_loadu_ps(p); }
+    static inline void store(float * p, const __m256 a) noexcept { _mm256_storeu_ps(p, a); }
+    static inline __m256 broadcast(const float * p) noexcept { return _mm256_broadcast_ss(p); }
+    static inline __m256 mul(const __m256 a, const __m256 b) noexcept { return _mm256_mul_ps(a, b); }
+    static inline __m256 fmadd(const __m256 a, const __m256 b, const __m256 c) noexcept { return _mm256_fmadd_ps(a, b, c); }
+};
+}
+
+// A 4x4 block row only fills half a 256-bit register, so that size runs on 128-bit vectors.
+template<int N>
+using Vector = typename std::conditional<N == 4, Xmm, Ymm>::type;
+
+template<int N, bool fused>
+void filter_avx2(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept {
+    filterBlocks<Vector<N>, N, fused>(blocks, count, d);
+}
+
+template<int N>
+void prune_avx2(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept {
+    pruneBlocks<Vector<N>, N>(blocks, count, d);
+}
+
+template<int N, bool inverse>
+void transform_avx2(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept {
+    transformBlocks<Vector<N>, N, inverse>(blocks, count, d);
+}
+
+template<int N>
+void analyze_avx2(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept {
+    analyzeBlocks<Vector<N>, N>(blocks, count, d);
+}
+
+static inline int pair(const int16_t * p) noexcept {
+    int value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+// Fixed-point Pv * X * Ph^T for 8x8 blocks of 16-bit samples, one output row of eight 32-bit sums per four vpmaddwd.
+void fixed_avx2(int16_t * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept {
+    const int first = 14 - d->fixedShift;
+    const int second = 14 + d->fixedShift;
+    const __m256i round1 = _mm256_set1_epi32(1 << (first - 1));
+    const __m256i round2 = _mm256_set1_epi32(1 << (second - 1));
+    const __m128i shift1 = _mm_cvtsi32_si128(first);
+    const __m128i shift2 = _mm_cvtsi32_si128(second);
+    const __m128i peak = _mm_set1_epi16(static_cast<int16_t>(d->peak));
+    __m256i horizontal[4];
+
+    for (int i = 0; i < 4; i++)
+        horizontal[i] = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(d->fixedHorizontal + 16 * i));
+
+    for (unsigned i = 0; i < count; i++) {
+        int16_t * block = blocks + 64 * i;
+        __m128i tmp[8];
+
+        for (int y = 0; y < 8; y++) {
+            __m256i sum = _mm256_setzero_si256();
+
+            for (int x = 0; x < 4; x++)
+                sum = _mm256_add_epi32(sum, _mm256_madd_epi16(_mm256_set1_epi32(pair(block + 8 * y + 2 * x)), horizontal[x]));
+
+            sum = _mm256_sra_epi32(_mm256_add_epi32(sum, round1), shift1);
+            tmp[y] = _mm_packs_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+        }
+
+        __m256i rows[4];
+
+        for (int y = 0; y < 4; y++) {
+            const __m128i lo = _mm_unpacklo_epi16(tmp[2 * y], tmp[2 * y + 1]);
+            const __m128i hi = _mm_unpackhi_epi16(tmp[2 * y], tmp[2 * y + 1]);
+            rows[y] = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+        }
+
+        for (int v = 0; v < 8; v++) {
+            __m256i sum = _mm256_setzero_si256();
+
+            for (int y = 0; y < 4; y++)
+                sum = _mm256_add_epi32(sum, _mm256_madd_epi16(rows[y], _mm256_set1_epi32(pair(d->fixedVertical + 8 * v + 2 * y))));
+
+            sum = _mm256_sra_epi32(_mm256_add_epi32(sum, round2), shift2);
+
+            const __m128i output = _mm_packs_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(block + 8 * v), _mm_min_epi16(_mm_max_epi16(output, _mm_setzero_si128()), peak));
+        }
+    }
+}
+
+// Every CPU with AVX2 so far also has F16C, but nothing guarantees it, so DCTFilter checks for it before picking these.
+void load_f16c(const uint16_t * VS_RESTRICT src, float * VS_RESTRICT dst, const unsigned n) noexcept {
+    unsigned i = 0;
+
+    for (; i + 8 <= n; i += 8)
+        _mm256_storeu_ps(dst + i, _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i))));
+
+    for (; i < n; i++)
+        dst[i] = _cvtsh_ss(src[i]);
+}
+
+void store_f16c(const float * VS_RESTRICT src, uint16_t * VS_RESTRICT dst, const unsigned n) noexcept {
+    unsigned i = 0;
+
+    for (; i + 8 <= n; i += 8)
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm256_cvtps_ph(_mm256_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT));
+
+    for (; i < n; i++)
+        dst[i] = _cvtss_sh(src[i], _MM_FROUND_TO_NEAREST_INT);
+}
+
+template void filter_avx2<4, false>(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept;
+template void filter_avx2<4, true>(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept;
+template void filter_avx2<8, false>(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept;
+template void filter_avx2<8, true>(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept;
+template void filter_avx2<16, false>(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept;
+template void filter_avx2<16, true>(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept;
+
+template void prune_avx2<4>(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept;
+template void prune_avx2<8>(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept;
+template void prune_avx2<16>(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept;
+
+template void transform_avx2<4, false>(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept;
+template void transform_avx2<4, true>(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept;
+template void transform_avx2<8, false>(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept;
+template void transform_avx2<8, true>(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept;
+template void transform_avx2<16, false>(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept;
+template void transform_avx2<16, true>(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept;
+
+template void analyze_avx2<4>(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept;
+template void analyze_avx2<8>(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept;
+template void analyze_avx2<16>(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept;
+#endif
@@ -0,0 +1,180 @@
+/*
+    MIT License
+
+    Copyright (c) 2017 HolyWu
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#ifdef DCTFILTER_X86
+#include <type_traits>
+
+#include <immintrin.h>
+
+#include "Transform.h"
+
+namespace {
+struct Xmm {
+    typedef __m128 type;
+    static constexpr int lanes = 4;
+
+    static inline __m128 zero() noexcept { return _mm_setzero_ps(); }
+    static inline __m128 load(const float * p) noexcept { return _mm_loadu_ps(p); }
+    static inline void store(float * p, const __m128 a) noexcept { _mm_storeu_ps(p, a); }
+    static inline __m128 broadcast(const float * p) noexcept { return _mm_broadcast_ss(p); }
+    static inline __m128 mul(const __m128 a, const __m128 b) noexcept { return _mm_mul_ps(a, b); }
+    static inline __m128 fmadd(const __m128 a, const __m128 b, const __m128 c) noexcept { return _mm_fmadd_ps(a, b, c); }
+};
+
+struct Ymm {
+    typedef __m256 type;
+    static constexpr int lanes = 8;
+
+    static inline __m256 zero() noexcept { return _mm256_setzero_ps(); }
+    static inline __m256 load(const float * p) noexcept { return _mm256_loadu_ps(p); }
+    static inline void store(float * p, const __m256 a) noexcept { _mm256_storeu_ps(p, a); }
+    static inline __m256 broadcast(const float * p) noexcept { return _mm256_broadcast_ss(p); }
+    static inline __m256 mul(const __m256 a, const __m256 b) noexcept { return _mm256_mul_ps(a, b); }
+    static inline __m256 fmadd(const __m256 a, const __m256 b, const __m256 c) noexcept { return _mm256_fmadd_ps(a, b, c); }
+};
+
+struct Zmm {
+    typedef __m512 type;
+    static constexpr int lanes = 16;
+
+    static inline __m512 zero() noexcept { return _mm512_setzero_ps(); }
+    static inline __m512 load(const float * p) noexcept { return _mm512_loadu_ps(p); }
+    static inline void store(float * p, const __m512 a) noexcept { _mm512_storeu_ps(p, a); }
+    static inline __m512 broadcast(const float * p) noexcept { return _mm512_set1_ps(*p); }
+    static inline __m512 mul(const __m512 a, const __m512 b) noexcept { return _mm512_mul_ps(a, b); }
+    static inline __m512 fmadd(const __m512 a, const __m512 b, const __m512 c) noexcept { return _mm512_fmadd_ps(a, b, c); }
+};
+}
+
+// Each block size runs on the widest vector one of its rows fills.
+template<int N>
+using Vector = typename std::conditional<N == 4, Xmm, typename std::conditional<N == 8, Ymm, Zmm>::type>::type;
+
+static inline __m512 duplicate(const float * p) noexcept {
+    const __m512 row = _mm512_maskz_loadu_ps(0x00FF, p);
+    return _mm512_maskz_shuffle_f32x4(0xFFFF, row, row, _MM_SHUFFLE(1, 0, 1, 0));
+}
+
+// Computes M * X * M^T for two adjacent 8x8 blocks at once, the low and high halves of each vector holding the same row of either block.
+template<bool scale>
+static inline void transform2(float * VS_RESTRICT block, const float * VS_RESTRICT matrix, const float * VS_RESTRICT factors) noexcept {
+    const float * transposed = matrix + 64;
+    const __m512i even = _mm512_setr_epi32(0, 0, 0, 0, 0, 0, 0, 0, 16, 16, 16, 16, 16, 16, 16, 16);
+    const __m512i odd = _mm512_add_epi32(even, _mm512_set1_epi32(8));
+    __m512 rows[8], tmp[8];
+
+    for (int x = 0; x < 8; x++)
+        rows[x] = duplicate(transposed + 8 * x);
+
+    for (int y = 0; y < 8; y += 2) {
+        const __m512 first = _mm512_loadu_ps(block + 8 * y);
+        const __m512 second = _mm512_loadu_ps(block + 64 + 8 * y);
+        __m512 sum0 = _mm512_setzero_ps();
+        __m512 sum1 = _mm512_setzero_ps();
+
+        for (int x = 0; x < 8; x++) {
+            const __m512i offset = _mm512_set1_epi32(x);
+            sum0 = _mm512_fmadd_ps(_mm512_permutex2var_ps(first, _mm512_add_epi32(even, offset), second), rows[x], sum0);
+            sum1 = _mm512_fmadd_ps(_mm512_permutex2var_ps(first, _mm512_add_epi32(odd, offset), second), rows[x], sum1);
+        }
+
+        tmp[y] = sum0;
+        tmp[y + 1] = sum1;
+    }
+
+    for (int v = 0; v < 8; v++) {
+        __m512 sum = _mm512_mul_ps(_mm512_set1_ps(matrix[8 * v]), tmp[0]);
+
+        for (int y = 1; y < 8; y++)
+            sum = _mm512_fmadd_ps(_mm512_set1_ps(matrix[8 * v + y]), tmp[y], sum);
+
+        if (scale)
+            sum = _mm512_mul_ps(sum, duplicate(factors + 8 * v));
+
+        _mm512_mask_storeu_ps(block + 8 * v, 0x00FF, sum);
+        _mm512_mask_storeu_ps(block + 56 + 8 * v, 0xFF00, sum);
+    }
+}
+
+template<int N, bool fused>
+void filter_avx512(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept {
+    if (N != 8) {
+        filterBlocks<Vector<N>, N, fused>(blocks, count, d);
+        return;
+    }
+
+    unsigned i = 0;
+
+    for (; i + 2 <= count; i += 2) {
+        float * block = blocks + 64 * i;
+
+        if (fused) {
+            transform2<false>(block, d->fusedMatrix, nullptr);
+        } else {
+            transform2<true>(block, d->dctMatrix, d->factors);
+            transform2<false>(block, d->idctMatrix, nullptr);
+        }
+    }
+
+    if (i < count)
+        filterBlocks<Ymm, 8, fused>(blocks + 64 * i, 1, d);
+}
+
+template<int N>
+void prune_avx512(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept {
+    pruneBlocks<Vector<N>, N>(blocks, count, d);
+}
+
+template<int N, bool inverse>
+void transform_avx512(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept {
+    transformBlocks<Vector<N>, N, inverse>(blocks, count, d);
+}
+
+template<int N>
+void analyze_avx512(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept {
+    analyzeBlocks<Vector<N>, N>(blocks, count, d);
+}
+
+template void filter_avx512<4, false>(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept;
+template void filter_avx512<4, true>(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept;
+template void filter_avx512<8, false>(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept;
+template void filter_avx512<8, true>(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept;
+template void filter_avx512<16, false>(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept;
+template void filter_avx512<16, true>(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept;
+
+template void prune_avx512<4>(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept;
+template void prune_avx512<8>(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept;
+template void prune_avx512<16>(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept;
+
+template void transform_avx512<4, false>(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept;
+template void transform_avx512<4, true>(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept;
+template void transform_avx512<8, false>(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept;
+template void transform_avx512<8, true>(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept;
+template void transform_avx512<16, false>(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept;
+template void transform_avx512<16, true>(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept;
+
+template void analyze_avx512<4>(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept;
+template void analyze_avx512<8>(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept;
+template void analyze_avx512<16>(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept;
+#endif
@@ -0,0 +1,171 @@
+/*
+    MIT License
+
+    Copyright (c) 2017 HolyWu
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#ifdef DCTFILTER_ARM
+#include <algorithm>
+
+#include <arm_neon.h>
+
+#include "Transform.h"
+
+namespace {
+struct Quad {
+    typedef float32x4_t type;
+    static constexpr int lanes = 4;
+
+    static inline float32x4_t zero() noexcept { return vdupq_n_f32(0.f); }
+    static inline float32x4_t load(const float * p) noexcept { return vld1q_f32(p); }
+    static inline void store(float * p, const float32x4_t a) noexcept { vst1q_f32(p, a); }
+    static inline float32x4_t broadcast(const float * p) noexcept { return vld1q_dup_f32(p); }
+    static inline float32x4_t mul(const float32x4_t a, const float32x4_t b) noexcept { return vmulq_f32(a, b); }
+
+    static inline float32x4_t fmadd(const float32x4_t a, const float32x4_t b, const float32x4_t c) noexcept {
+#ifdef __aarch64__
+        return vfmaq_f32(c, a, b);
+#else
+        return vmlaq_f32(c, a, b);
+#endif
+    }
+};
+}
+
+template<int N, bool fused>
+void filter_neon(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept {
+    filterBlocks<Quad, N, fused>(blocks, count, d);
+}
+
+template<int N>
+void prune_neon(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept {
+    pruneBlocks<Quad, N>(blocks, count, d);
+}
+
+template<int N, bool inverse>
+void transform_neon(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept {
+    transformBlocks<Quad, N, inverse>(blocks, count, d);
+}
+
+template<int N>
+void analyze_neon(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept {
+    analyzeBlocks<Quad, N>(blocks, count, d);
+}
+
+// Fixed-point Pv * X * Ph^T for 8x8 blocks of 16-bit samples, widening multiply-accumulates into 32-bit lanes.
+void fixed_neon(int16_t * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept {
+    const int32x4_t shift1 = vdupq_n_s32(d->fixedShift - 14);
+    const int32x4_t shift2 = vdupq_n_s32(-14 - d->fixedShift);
+    const int16x8_t peak = vdupq_n_s16(static_cast<int16_t>(d->peak));
+    int16x8_t horizontal[8];
+
+    for (int i = 0; i < 4; i++) {
+        const int16x8x2_t columns = vld2q_s16(d->fixedHorizontal + 16 * i);
+        horizontal[2 * i] = columns.val[0];
+        horizontal[2 * i + 1] = columns.val[1];
+    }
+
+    for (unsigned i = 0; i < count; i++) {
+        int16_t * block = blocks + 64 * i;
+        int16x8_t tmp[8];
+
+        for (int y = 0; y < 8; y++) {
+            int32x4_t lo = vdupq_n_s32(0);
+            int32x4_t hi = vdupq_n_s32(0);
+
+            for (int x = 0; x < 8; x++) {
+                lo = vmlal_n_s16(lo, vget_low_s16(horizontal[x]), block[8 * y + x]);
+                hi = vmlal_n_s16(hi, vget_high_s16(horizontal[x]), block[8 * y + x]);
+            }
+
+            tmp[y] = vcombine_s16(vqmovn_s32(vrshlq_s32(lo, shift1)), vqmovn_s32(vrshlq_s32(hi, shift1)));
+        }
+
+        for (int v = 0; v < 8; v++) {
+            int32x4_t lo = vdupq_n_s32(0);
+            int32x4_t hi = vdupq_n_s32(0);
+
+            for (int y = 0; y < 8; y++) {
+                lo = vmlal_n_s16(lo, vget_low_s16(tmp[y]), d->fixedVertical[8 * v + y]);
+                hi = vmlal_n_s16(hi, vget_high_s16(tmp[y]), d->fixedVertical[8 * v + y]);
+            }
+
+            const int16x8_t output = vcombine_s16(vqmovn_s32(vrshlq_s32(lo, shift2)), vqmovn_s32(vrshlq_s32(hi, shift2)));
+            vst1q_s16(block + 8 * v, vminq_s16(vmaxq_s16(output, vdupq_n_s16(0)), peak));
+        }
+    }
+}
+
+#ifdef __aarch64__
+// The last few samples of a row go through a zero-padded group of four.
+void load_neon(const uint16_t * VS_RESTRICT src, float * VS_RESTRICT dst, const unsigned n) noexcept {
+    unsigned i = 0;
+
+    for (; i + 4 <= n; i += 4)
+        vst1q_f32(dst + i, vcvt_f32_f16(vreinterpret_f16_u16(vld1_u16(src + i))));
+
+    if (i < n) {
+        uint16_t input[4] = {};
+        float output[4];
+        std::copy_n(src + i, n - i, input);
+        vst1q_f32(output, vcvt_f32_f16(vreinterpret_f16_u16(vld1_u16(input))));
+        std::copy_n(output, n - i, dst + i);
+    }
+}
+
+void store_neon(const float * VS_RESTRICT src, uint16_t * VS_RESTRICT dst, const unsigned n) noexcept {
+    unsigned i = 0;
+
+    for (; i + 4 <= n; i += 4)
+        vst1_u16(dst + i, vreinterpret_u16_f16(vcvt_f16_f32(vld1q_f32(src + i))));
+
+    if (i < n) {
+        float input[4] = {};
+        uint16_t output[4];
+        std::copy_n(src + i, n - i, input);
+        vst1_u16(output, vreinterpret_u16_f16(vcvt_f16_f32(vld1q_f32(input))));
+        std::copy_n(output, n - i, dst + i);
+    }
+}
+#endif
+
+template void filter_neon<4, false>(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept;
+template void filter_neon<4, true>(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept;
+template void filter_neon<8, false>(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept;
+template void filter_neon<8, true>(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept;
+template void filter_neon<16, false>(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept;
+template void filter_neon<16, true>(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept;
+
+template void prune_neon<4>(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept;
+template void prune_neon<8>(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept;
+template void prune_neon<16>(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept;
+
+template void transform_neon<4, false>(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept;
+template void transform_neon<4, true>(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept;
+template void transform_neon<8, false>(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept;
+template void transform_neon<8, true>(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept;
+template void transform_neon<16, false>(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept;
+template void transform_neon<16, true>(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept;
+
+template void analyze_neon<4>(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept;
+template void analyze_neon<8>(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept;
+template void analyze_neon<16>(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept;
+#endif
@@ -0,0 +1,153 @@
+/*
+    MIT License
+
+    Copyright (c) 2017 HolyWu
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#ifdef DCTFILTER_X86
+#include <cstring>
+
+#include <emmintrin.h>
+
+#include "Transform.h"
+
+namespace {
+struct Xmm {
+    typedef __m128 type;
+    static constexpr int lanes = 4;
+
+    static inline __m128 zero() noexcept { return _mm_setzero_ps(); }
+    static inline __m128 load(const float * p) noexcept { return _mm_loadu_ps(p); }
+    static inline void store(float * p, const __m128 a) noexcept { _mm_storeu_ps(p, a); }
+    static inline __m128 broadcast(const float * p) noexcept { return _mm_set1_ps(*p); }
+    static inline __m128 mul(const __m128 a, const __m128 b) noexcept { return _mm_mul_ps(a, b); }
+    static inline __m128 fmadd(const __m128 a, const __m128 b, const __m128 c) noexcept { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+};
+}
+
+template<int N, bool fused>
+void filter_sse2(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept {
+    filterBlocks<Xmm, N, fused>(blocks, count, d);
+}
+
+template<int N>
+void prune_sse2(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept {
+    pruneBlocks<Xmm, N>(blocks, count, d);
+}
+
+template<int N, bool inverse>
+void transform_sse2(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept {
+    transformBlocks<Xmm, N, inverse>(blocks, count, d);
+}
+
+template<int N>
+void analyze_sse2(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept {
+    analyzeBlocks<Xmm, N>(blocks, count, d);
+}
+
+static inline int pair(const int16_t * p) noexcept {
+    int value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+// Fixed-point Pv * X * Ph^T for 8x8 blocks of 16-bit samples. pmaddwd multiplies pairs of adjacent terms and sums them into 32-bit lanes,
+// so each pass takes four multiply-adds per output row; the intermediate rows keep fixedShift fractional bits.
+void fixed_sse2(int16_t * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept {
+    const int first = 14 - d->fixedShift;
+    const int second = 14 + d->fixedShift;
+    const __m128i round1 = _mm_set1_epi32(1 << (first - 1));
+    const __m128i round2 = _mm_set1_epi32(1 << (second - 1));
+    const __m128i shift1 = _mm_cvtsi32_si128(first);
+    const __m128i shift2 = _mm_cvtsi32_si128(second);
+    const __m128i peak = _mm_set1_epi16(static_cast<int16_t>(d->peak));
+    __m128i horizontal[8];
+
+    for (int i = 0; i < 8; i++)
+        horizontal[i] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(d->fixedHorizontal + 8 * i));
+
+    for (unsigned i = 0; i < count; i++) {
+        int16_t * block = blocks + 64 * i;
+        __m128i tmp[8];
+
+        for (int y = 0; y < 8; y++) {
+            __m128i lo = _mm_setzero_si128();
+            __m128i hi = _mm_setzero_si128();
+
+            for (int x = 0; x < 4; x++) {
+                const __m128i input = _mm_set1_epi32(pair(block + 8 * y + 2 * x));
+                lo = _mm_add_epi32(lo, _mm_madd_epi16(input, horizontal[2 * x]));
+                hi = _mm_add_epi32(hi, _mm_madd_epi16(input, horizontal[2 * x + 1]));
+            }
+
+            lo = _mm_sra_epi32(_mm_add_epi32(lo, round1), shift1);
+            hi = _mm_sra_epi32(_mm_add_epi32(hi, round1), shift1);
+            tmp[y] = _mm_packs_epi32(lo, hi);
+        }
+
+        __m128i rows[8];
+
+        for (int y = 0; y < 4; y++) {
+            rows[2 * y] = _mm_unpacklo_epi16(tmp[2 * y], tmp[2 * y + 1]);
+            rows[2 * y + 1] = _mm_unpackhi_epi16(tmp[2 * y], tmp[2 * y + 1]);
+        }
+
+        for (int v = 0; v < 8; v++) {
+            __m128i lo = _mm_setzero_si128();
+            __m128i hi = _mm_setzero_si128();
+
+            for (int y = 0; y < 4; y++) {
+                const __m128i coeff = _mm_set1_epi32(pair(d->fixedVertical + 8 * v + 2 * y));
+                lo = _mm_add_epi32(lo, _mm_madd_epi16(rows[2 * y], coeff));
+                hi = _mm_add_epi32(hi, _mm_madd_epi16(rows[2 * y + 1], coeff));
+            }
+
+            lo = _mm_sra_epi32(_mm_add_epi32(lo, round2), shift2);
+            hi = _mm_sra_epi32(_mm_add_epi32(hi, round2), shift2);
+
+            const __m128i output = _mm_min_epi16(_mm_max_epi16(_mm_packs_epi32(lo, hi), _mm_setzero_si128()), peak);
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(block + 8 * v), output);
+        }
+    }
+}
+
+template void filter_sse2<4, false>(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept;
+template void filter_sse2<4, true>(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept;
+template void filter_sse2<8, false>(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept;
+template void filter_sse2<8, true>(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept;
+template void filter_sse2<16, false>(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept;
+template void filter_sse2<16, true>(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept;
+
+template void prune_sse2<4>(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept;
+template void prune_sse2<8>(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept;
+template void prune_sse2<16>(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept;
+
+template void transform_sse2<4, false>(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept;
+template void transform_sse2<4, true>(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept;
+template void transform_sse2<8, false>(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept;
+template void transform_sse2<8, true>(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept;
+template void transform_sse2<16, false>(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept;
+template void transform_sse2<16, true>(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept;
+
+template void analyze_sse2<4>(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept;
+template void analyze_sse2<8>(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept;
+template void analyze_sse2<16>(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept;
+#endif
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+// Helper threads shared by every filter instance. A job is a range of independent task indices which the submitting thread and up to
+// the requested number of helpers claim one at a time, so idle threads keep taking work until the range is drained. The submitting
+// thread never waits for a task nobody has started, so a busy pool only costs parallelism, not progress. Given a list of CPUs, every
+// helper only runs on those, where the platform allows it.
+class ThreadPool {
+public:
+    explicit ThreadPool(const unsigned numThreads, const std::vector<int> & cpus = {}) : affinity{ cpus } {
+        for (unsigned i = 0; i < numThreads; i++)
+            workers.emplace_back(&ThreadPool::worker, this);
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock{ mutex };
+            stop = true;
+        }
+
+        wake.notify_all();
+
+        for (auto & thread : workers)
+            thread.join();
+    }
+
+    unsigned size() const noexcept {
+        return static_cast<unsigned>(workers.size());
+    }
+
+    void run(const unsigned count, const unsigned helpers, const std::function<void(unsigned)> & func) {
+        Job job{ func, count, std::min(helpers, count - 1) };
+
+        if (job.helpers > 0) {
+            {
+                std::lock_guard<std::mutex> lock{ mutex };
+                jobs.push_back(&job);
+            }
+
+            for (unsigned i = 0; i < job.helpers; i++)
+                wake.notify_one();
+        }
+
+        execute(job);
+
+        if (job.helpers > 0) {
+            std::unique_lock<std::mutex> lock{ mutex };
+
+            const auto iter = std::find(jobs.begin(), jobs.end(), &job);
+            if (iter != jobs.end())
+                jobs.erase(iter);
+
+            job.finished.wait(lock, [&] { return job.active == 0; });
+        }
+    }
+
+private:
+    struct Job {
+        Job(const std::function<void(unsigned)> & f, const unsigned c, const unsigned h) : func{ f }, count{ c }, helpers{ h } {}
+
+        const std::function<void(unsigned)> & func;
+        const unsigned count;
+        const unsigned helpers;
+        std::atomic<unsigned> next{ 0 };
+        unsigned joined = 0;
+        unsigned active = 0;
+        std::condition_variable finished;
+    };
+
+    static void execute(Job & job) {
+        for (unsigned i = job.next++; i < job.count; i = job.next++)
+            job.func(i);
+    }
+
+    void worker() {
+#ifdef __linux__
+        if (!affinity.empty()) {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            for (const int cpu : affinity) {
+                if (cpu < CPU_SETSIZE)
+                    CPU_SET(cpu, &set);
+            }
+            pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        }
+#endif
+
+        std::unique_lock<std::mutex> lock{ mutex };
+
+        while (true) {
+            wake.wait(lock, [&] { return stop || !jobs.empty(); });
+
+            if (stop)
+                return;
+
+            Job * job = jobs.front();
+
+            if (job->joined >= job->helpers || job->next >= job->count) {
+                jobs.pop_front();
+                continue;
+            }
+
+            job->joined++;
+            job->active++;
+
+            lock.unlock();
+            execute(*job);
+            lock.lock();
+
+            if (--job->active == 0)
+                job->finished.notify_all();
+        }
+    }
+
+    const std::vector<int> affinity;
+    std::vector<std::thread> workers;
+    std::deque<Job *> jobs;
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool stop = false;
+};
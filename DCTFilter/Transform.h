@@ -0,0 +1,145 @@
+#pragma once
+
+#include "DCTFilter.h"
+
+// Block kernels shared by the SIMD implementations. V is a traits class wrapping one vector type of the including translation unit's
+// instruction set, so every file instantiates these with its own flags. N is the block size and must be a multiple of V::lanes.
+
+// Computes M * X * M^T for one NxN block, optionally scaling the result by the factors.
+template<typename V, int N, bool scale>
+static inline void transform(float * VS_RESTRICT block, const float * VS_RESTRICT matrix, const float * VS_RESTRICT factors) noexcept {
+    constexpr int W = N / V::lanes;
+    const float * transposed = matrix + N * N;
+    typename V::type tmp[N][W];
+
+    for (int y = 0; y < N; y++) {
+        for (int j = 0; j < W; j++) {
+            typename V::type sum = V::mul(V::broadcast(block + N * y), V::load(transposed + V::lanes * j));
+
+            for (int x = 1; x < N; x++)
+                sum = V::fmadd(V::broadcast(block + N * y + x), V::load(transposed + N * x + V::lanes * j), sum);
+
+            tmp[y][j] = sum;
+        }
+    }
+
+    for (int v = 0; v < N; v++) {
+        for (int j = 0; j < W; j++) {
+            typename V::type sum = V::mul(V::broadcast(matrix + N * v), tmp[0][j]);
+
+            for (int y = 1; y < N; y++)
+                sum = V::fmadd(V::broadcast(matrix + N * v + y), tmp[y][j], sum);
+
+            if (scale)
+                sum = V::mul(sum, V::load(factors + N * v + V::lanes * j));
+
+            V::store(block + N * v + V::lanes * j, sum);
+        }
+    }
+}
+
+// Computes IDCT(F .* DCT(X)) for one NxN block, visiting only the frequency rows and columns with a nonzero weight.
+template<typename V, int N>
+static inline void prune(float * VS_RESTRICT block, const DCTFilterData * VS_RESTRICT d) noexcept {
+    constexpr int W = N / V::lanes;
+    const float * dct = d->dctMatrix;
+    const float * idct = d->idctMatrix;
+    float coeffs[N * N];
+    typename V::type src[N][W], tmp[N][W];
+
+    for (int y = 0; y < N; y++) {
+        for (int j = 0; j < W; j++)
+            src[y][j] = V::load(block + N * y + V::lanes * j);
+    }
+
+    for (int i = 0; i < d->numRows; i++) {
+        const float * row = dct + N * d->rows[i];
+
+        for (int j = 0; j < W; j++) {
+            typename V::type sum = V::mul(V::broadcast(row), src[0][j]);
+
+            for (int y = 1; y < N; y++)
+                sum = V::fmadd(V::broadcast(row + y), src[y][j], sum);
+
+            V::store(coeffs + N * i + V::lanes * j, sum);
+        }
+    }
+
+    for (int i = 0; i < d->numRows; i++) {
+        const float * factors = d->factors + N * d->rows[i];
+        typename V::type sum[W];
+
+        for (int j = 0; j < W; j++) {
+            sum[j] = V::mul(V::broadcast(coeffs + N * i), V::load(dct + N * N + V::lanes * j));
+
+            for (int x = 1; x < N; x++)
+                sum[j] = V::fmadd(V::broadcast(coeffs + N * i + x), V::load(dct + N * N + N * x + V::lanes * j), sum[j]);
+        }
+
+        for (int j = 0; j < W; j++)
+            V::store(coeffs + N * i + V::lanes * j, V::mul(sum[j], V::load(factors + V::lanes * j)));
+    }
+
+    for (int i = 0; i < d->numRows; i++) {
+        for (int j = 0; j < W; j++) {
+            typename V::type sum = V::zero();
+
+            for (int k = 0; k < d->numColumns; k++) {
+                const int u = d->columns[k];
+                sum = V::fmadd(V::broadcast(coeffs + N * i + u), V::load(idct + N * N + N * u + V::lanes * j), sum);
+            }
+
+            tmp[i][j] = sum;
+        }
+    }
+
+    for (int y = 0; y < N; y++) {
+        for (int j = 0; j < W; j++) {
+            typename V::type sum = V::zero();
+
+            for (int i = 0; i < d->numRows; i++)
+                sum = V::fmadd(V::broadcast(idct + N * y + d->rows[i]), tmp[i][j], sum);
+
+            V::store(block + N * y + V::lanes * j, sum);
+        }
+    }
+}
+
+template<typename V, int N, bool fused>
+static inline void filterBlocks(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept {
+    for (unsigned i = 0; i < count; i++) {
+        float * block = blocks + N * N * i;
+
+        if (fused) {
+            transform<V, N, false>(block, d->fusedMatrix, nullptr);
+        } else {
+            transform<V, N, true>(block, d->dctMatrix, d->factors);
+            transform<V, N, false>(block, d->idctMatrix, nullptr);
+        }
+    }
+}
+
+template<typename V, int N>
+static inline void pruneBlocks(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept {
+    for (unsigned i = 0; i < count; i++)
+        prune<V, N>(blocks + N * N * i, d);
+}
+
+// Runs one half of the round trip for the coefficient modes: the weighted DCT of pixel blocks, or the IDCT of coefficient blocks.
+// idctMatrix and the factors already hold the scaling to and from orthonormal coefficients.
+template<typename V, int N, bool inverse>
+static inline void transformBlocks(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept {
+    for (unsigned i = 0; i < count; i++) {
+        if (inverse)
+            transform<V, N, false>(blocks + N * N * i, d->idctMatrix, nullptr);
+        else
+            transform<V, N, true>(blocks + N * N * i, d->dctMatrix, d->factors);
+    }
+}
+
+// Computes the unnormalized, unweighted DCT of every block, for measuring the energy of the source.
+template<typename V, int N>
+static inline void analyzeBlocks(float * VS_RESTRICT blocks, const unsigned count, const DCTFilterData * VS_RESTRICT d) noexcept {
+    for (unsigned i = 0; i < count; i++)
+        transform<V, N, false>(blocks + N * N * i, d->dctMatrix, nullptr);
+}
@@ -0,0 +1,740 @@
+/*
+    MIT License
+
+    Copyright (c) 2017 HolyWu
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+// Standalone benchmark of DCTFilter. The plugin is linked in and its DCTFilter function is called directly on a core of the VapourSynth
+// library, so every measurement goes through the same frame path as a script, on a single thread, with synthetic gray planes. Every run
+// is also checked against a double precision reference of the filter, and the exit status is 1 when any run is off by more than its
+// format allows. With "check" nothing is timed; instead every other block size, overlap, temporal radius, flat threshold, strength, zigzag
+// order, plane selection, in-place filtering, DCTFilterMulti and the round trip through DCTFilterInverse are checked on small gray and
+// YUV420 frames of odd size, several of them split between threads, along with the energy and block counts they report. That is what
+// the test suite runs.
+//
+// Usage: dctfilter_bench [frames [width height]]
+//        dctfilter_bench check
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#ifdef DCTFILTER_X86
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#endif
+
+#include <VapourSynth4.h>
+
+VS_EXTERNAL_API(void) VapourSynthPluginInit2(VSPlugin *plugin, const VSPLUGINAPI *vspapi);
+
+static VSPublicFunction dctfilterCreate, dctfilterMultiCreate, dctfilterInverseCreate;
+
+static int VS_CC configPlugin(const char *, const char *, const char *, int, int, int, VSPlugin *) {
+    return 1;
+}
+
+static int VS_CC registerFunction(const char * name, const char *, const char *, VSPublicFunction argsFunc, void *, VSPlugin *) {
+    if (std::string{ name } == "DCTFilter")
+        dctfilterCreate = argsFunc;
+    else if (std::string{ name } == "DCTFilterMulti")
+        dctfilterMultiCreate = argsFunc;
+    else if (std::string{ name } == "DCTFilterInverse")
+        dctfilterInverseCreate = argsFunc;
+    return 1;
+}
+
+struct SourceData {
+    VSVideoInfo vi;
+    VSFrame * frames[2];
+};
+
+// Frame 0 holds content and every other frame noise. Frame 0 is one of the untimed ones, so its accuracy is checked without it being
+// part of the measurement.
+static const VSFrame *VS_CC sourceGetFrame(int n, int activationReason, void *instanceData, void **frameData, VSFrameContext *frameCtx, VSCore *core, const VSAPI *vsapi) {
+    SourceData * d = static_cast<SourceData *>(instanceData);
+    return activationReason == arInitial ? vsapi->addFrameRef(d->frames[n == 0]) : nullptr;
+}
+
+static void VS_CC sourceFree(void *instanceData, VSCore *core, const VSAPI *vsapi) {
+    SourceData * d = static_cast<SourceData *>(instanceData);
+    vsapi->freeFrame(d->frames[0]);
+    vsapi->freeFrame(d->frames[1]);
+    delete d;
+}
+
+static double readSample(const uint8_t * row, const int x, const VSVideoFormat & format) noexcept {
+    if (format.sampleType == stFloat && format.bytesPerSample == 2) {
+        const uint16_t bits = reinterpret_cast<const uint16_t *>(row)[x];
+        const int exponent = (bits >> 10) & 0x1F;
+        const double magnitude = exponent ? std::ldexp(1024 + (bits & 0x3FF), exponent - 25) : std::ldexp(bits & 0x3FF, -24);
+        return bits & 0x8000 ? -magnitude : magnitude;
+    } else if (format.sampleType == stFloat) {
+        return reinterpret_cast<const float *>(row)[x];
+    } else if (format.bytesPerSample == 1) {
+        return row[x];
+    } else {
+        return reinterpret_cast<const uint16_t *>(row)[x];
+    }
+}
+
+// value is in [0, 1).
+static void writeSample(uint8_t * row, const int x, const VSVideoFormat & format, const float value) noexcept {
+    // Every bit pattern below 0x3C00 is a half precision value in [0, 1).
+    if (format.sampleType == stFloat && format.bytesPerSample == 2)
+        reinterpret_cast<uint16_t *>(row)[x] = static_cast<uint16_t>(value * 0x3C00);
+    else if (format.sampleType == stFloat)
+        reinterpret_cast<float *>(row)[x] = value;
+    else if (format.bytesPerSample == 1)
+        row[x] = static_cast<uint8_t>(value * 255);
+    else
+        reinterpret_cast<uint16_t *>(row)[x] = static_cast<uint16_t>(value * ((1 << format.bitsPerSample) - 1));
+}
+
+// Every frame carries it as BenchStrength for the runs with a strength property.
+static const double benchStrength = 0.3;
+
+// The timed frames are noise, which no kernel can take a shortcut on. The content frame stands in for real footage with smooth gradients
+// crossed by hard edges, where the weighted high frequencies ring the most, below a letterbox bar with a ripple of an 8 bit step. Every
+// plane is drawn alike, and seed picks the noise.
+static VSNode * createSource(const VSVideoFormat & format, const int width, const int height, const uint32_t seed, VSCore * core, const VSAPI * vsapi) {
+    SourceData * d = new SourceData{};
+    d->vi = { format, 24, 1, width, height, 1 << 30 };
+    uint32_t state = seed;
+
+    for (int content = 0; content < 2; content++) {
+        d->frames[content] = vsapi->newVideoFrame(&format, width, height, nullptr, core);
+        vsapi->mapSetFloat(vsapi->getFramePropertiesRW(d->frames[content]), "BenchStrength", benchStrength, maReplace);
+
+        for (int plane = 0; plane < format.numPlanes; plane++) {
+            const int planeWidth = vsapi->getFrameWidth(d->frames[content], plane);
+            const int planeHeight = vsapi->getFrameHeight(d->frames[content], plane);
+            const int stride = vsapi->getStride(d->frames[content], plane);
+            uint8_t * dstp = vsapi->getWritePtr(d->frames[content], plane);
+
+            for (int y = 0; y < planeHeight; y++) {
+                for (int x = 0; x < planeWidth; x++) {
+                    state = state * 1664525 + 1013904223;
+                    const float noise = (state >> 8) / 16777216.f;
+                    const float gradient = 0.45f + 0.3f * std::sin(x * 0.013f + y * 0.007f) * std::cos(y * 0.021f) + ((x / 97 + y / 61) % 2 ? 0.2f : -0.2f);
+
+                    const float value = y < planeHeight / 8 ? 0.0625f + ((x + y) & 1) / 255.f : std::min(std::max(gradient + 0.02f * noise, 0.f), 0.999f);
+
+                    writeSample(dstp, x, format, content ? value : noise);
+                }
+
+                dstp += stride;
+            }
+        }
+    }
+
+    return vsapi->createVideoFilter2("BenchSource", &d->vi, sourceGetFrame, sourceFree, fmParallel, nullptr, 0, d, core);
+}
+
+// What a run asks the filter for. Everything after fixed is only varied by the accuracy check.
+struct Kernel {
+    Kernel(const char * name_, const std::vector<double> & factors_, const bool fixed_) : name{ name_ }, factors{ factors_ }, fixed{ fixed_ } {}
+
+    const char * name;
+    std::vector<double> factors;
+    bool fixed;
+    int blocksize = 8, overlap = 1, radius = 0, threads = 1;
+    std::vector<double> tfactors;
+    double flat = 0.;
+    // Planes to filter, one bit each, or 0 for all of them.
+    int planes = 0;
+    bool strength = false, coeffs = false, zigzag = false, inplace = false, multi = false;
+
+    bool filters(const int plane) const noexcept {
+        return !planes || (planes >> plane & 1);
+    }
+};
+
+// Position of coefficient (v, u) of an N x N block in the zigzag scan order of JPEG, which runs down the odd anti-diagonals and up the
+// even ones.
+static int zigzagIndex(const int N, const int v, const int u) noexcept {
+    const int diagonal = v + u;
+    const int first = std::max(diagonal - N + 1, 0);
+    const int last = std::min(diagonal, N - 1);
+    int index = 0;
+
+    for (int i = 0; i < diagonal; i++)
+        index += std::min(i, 2 * N - 2 - i) + 1;
+
+    return index + (diagonal & 1 ? v - first : last - v);
+}
+
+// The flat threshold is given in 8 bit steps.
+static double flatThreshold(const Kernel & kernel, const VSVideoFormat & format) noexcept {
+    return kernel.flat / 255 * (format.sampleType == stFloat ? 1. : (1 << format.bitsPerSample) - 1);
+}
+
+// Largest absolute difference from the reference, in units of the integer step or as a float, and the PSNR against the format's peak.
+struct Accuracy {
+    double maxError, psnr;
+};
+
+// What the filter should return for one plane of a frame: the pixels, unclamped, the weighted coefficients of every block of the unshifted
+// grid in place of its pixels, the mean energy of each zigzag band of the source's unweighted coefficients, and the number of blocks
+// transformed. Planes left alone come back as they are, neither measured nor counted.
+struct Reference {
+    std::vector<double> pixels, coefficients, energy;
+    int64_t blocks;
+};
+
+// Filters plane of frame n of source in double precision the way the kernel asks: the frames around n blended by the temporal factors,
+// then every block of every grid, edges replicated, taken through an orthonormal DCT, weighted by the row and column factors or the full
+// matrix, in row-major or zigzag order, moved towards 1 by the strength, and transformed back, unless it is flat, and the grids averaged.
+static Reference reference(VSNode * source, const int n, const int plane, const Kernel & kernel, const VSAPI * vsapi) {
+    const VSVideoInfo * vi = vsapi->getVideoInfo(source);
+    const int width = plane ? vi->width >> vi->format.subSamplingW : vi->width;
+    const int height = plane ? vi->height >> vi->format.subSamplingH : vi->height;
+    const int N = kernel.blocksize;
+    const int frames = 2 * kernel.radius + 1;
+    const double flat = flatThreshold(kernel, vi->format);
+    const double pi = std::acos(-1.);
+    // The filter rounds the strength to a multiple of 1/64.
+    const double strength = kernel.strength ? std::lround(benchStrength * 64) / 64. : 1.;
+    auto scale = [&](const double factor) { return factor + (1. - strength) * (1. - factor); };
+
+    std::vector<double> basis(N * N), weights(N * N), blend(frames);
+
+    for (int k = 0; k < N; k++) {
+        for (int i = 0; i < N; i++)
+            basis[N * k + i] = std::sqrt((k ? 2. : 1.) / N) * std::cos(pi * (2 * i + 1) * k / (2 * N));
+    }
+
+    for (int i = 0; i < N * N; i++)
+        weights[i] = kernel.factors.size() == static_cast<size_t>(N) ? scale(kernel.factors[i / N]) * scale(kernel.factors[i % N])
+                     : scale(kernel.factors[kernel.zigzag ? zigzagIndex(N, i / N, i % N) : i]);
+
+    // The centre frame of the temporal DCT round trip, with the temporal factors in between.
+    for (int j = 0; j < frames; j++) {
+        for (int k = 0; k < frames; k++)
+            blend[j] += (k ? 2. : 1.) / frames * std::cos(pi * frames * k / (2. * frames)) * std::cos(pi * (2 * j + 1) * k / (2. * frames)) *
+                        (kernel.radius ? scale(kernel.tfactors[k]) : 1.);
+    }
+
+    std::vector<double> pixels(width * height), centre(width * height);
+
+    for (int j = 0; j < frames; j++) {
+        const VSFrame * frame = vsapi->getFrame(std::min(std::max(n - kernel.radius + j, 0), vi->numFrames - 1), source, nullptr, 0);
+
+        for (int y = 0; y < height; y++) {
+            const uint8_t * row = vsapi->getReadPtr(frame, plane) + vsapi->getStride(frame, plane) * y;
+
+            for (int x = 0; x < width; x++) {
+                const double value = readSample(row, x, vi->format);
+                pixels[width * y + x] += blend[j] * value;
+                if (j == kernel.radius)
+                    centre[width * y + x] = value;
+            }
+        }
+
+        vsapi->freeFrame(frame);
+    }
+
+    Reference result{ {}, {}, std::vector<double>(N), 0 };
+
+    if (!kernel.filters(plane)) {
+        result.pixels = centre;
+        return result;
+    }
+
+    result.pixels.assign(width * height, 0.);
+    const int paddedWidth = (width + N - 1) / N * N;
+    result.coefficients.assign(paddedWidth * ((height + N - 1) / N * N), 0.);
+
+    std::vector<double> block(N * N), tmp(N * N);
+
+    auto gather = [&](const std::vector<double> & from, const int top, const int left) {
+        for (int y = 0; y < N; y++) {
+            for (int x = 0; x < N; x++)
+                block[N * y + x] = from[width * std::min(std::max(top + y, 0), height - 1) + std::min(std::max(left + x, 0), width - 1)];
+        }
+    };
+
+    // Rows, then columns; the forward transform takes the basis as it is and the inverse its transpose.
+    auto transform = [&](const bool inverse) {
+        for (int y = 0; y < N; y++) {
+            for (int u = 0; u < N; u++) {
+                double sum = 0;
+                for (int x = 0; x < N; x++)
+                    sum += block[N * y + x] * (inverse ? basis[N * x + u] : basis[N * u + x]);
+                tmp[N * y + u] = sum;
+            }
+        }
+
+        for (int v = 0; v < N; v++) {
+            for (int u = 0; u < N; u++) {
+                double sum = 0;
+                for (int y = 0; y < N; y++)
+                    sum += tmp[N * y + u] * (inverse ? basis[N * y + v] : basis[N * v + y]);
+                block[N * v + u] = sum;
+            }
+        }
+    };
+
+    // The energy is that of the source frame alone, flat blocks included.
+    const double blocks = static_cast<double>((width + N - 1) / N) * ((height + N - 1) / N);
+
+    for (int top = 0; top < height; top += N) {
+        for (int left = 0; left < width; left += N) {
+            gather(centre, top, left);
+            transform(false);
+
+            for (int i = 0; i < N * N; i++)
+                result.energy[zigzagIndex(N, i / N, i % N) / N] += block[i] * block[i] / blocks;
+        }
+    }
+
+    for (int grid = 0; grid < kernel.overlap; grid++) {
+        // Two grids are offset diagonally by half a block, four take every combination of a vertical and horizontal one.
+        const int shiftY = grid && (kernel.overlap == 2 || grid >= 2) ? N / 2 : 0;
+        const int shiftX = grid && (kernel.overlap == 2 || (grid & 1)) ? N / 2 : 0;
+
+        for (int top = -shiftY; top < height; top += N) {
+            for (int left = -shiftX; left < width; left += N) {
+                gather(pixels, top, left);
+
+                const auto range = std::minmax_element(block.begin(), block.end());
+
+                if (flat <= 0. || *range.second - *range.first > flat) {
+                    transform(false);
+
+                    for (int i = 0; i < N * N; i++)
+                        block[i] *= weights[i];
+
+                    for (int y = 0; !grid && y < N; y++)
+                        std::copy_n(&block[N * y], N, &result.coefficients[paddedWidth * (top + y) + left]);
+
+                    transform(true);
+                    result.blocks++;
+                }
+
+                for (int y = std::max(top, 0); y < std::min(top + N, height); y++) {
+                    for (int x = std::max(left, 0); x < std::min(left + N, width); x++)
+                        result.pixels[width * y + x] += block[N * (y - top) + x - left] / kernel.overlap;
+                }
+            }
+        }
+    }
+
+    return result;
+}
+
+// Compares plane of frame with expected, with the errors divided by unit and the PSNR taken against range. Integer samples of expected
+// are clamped to the peak but not rounded, so a perfect result of an integer format is still half a step off.
+static Accuracy compare(const VSFrame * frame, const int plane, const std::vector<double> & expected, const double unit, const double range,
+                        const VSAPI * vsapi) {
+    const VSVideoFormat & format = *vsapi->getVideoFrameFormat(frame);
+    const int width = vsapi->getFrameWidth(frame, plane);
+    const int height = vsapi->getFrameHeight(frame, plane);
+    const double peak = format.sampleType == stFloat ? 1. : (1 << format.bitsPerSample) - 1;
+    double maxError = 0, squares = 0;
+
+    for (int y = 0; y < height; y++) {
+        const uint8_t * row = vsapi->getReadPtr(frame, plane) + vsapi->getStride(frame, plane) * y;
+
+        for (int x = 0; x < width; x++) {
+            const double value = expected[width * y + x];
+            const double error = std::abs(readSample(row, x, format) - (format.sampleType == stFloat ? value : std::min(std::max(value, 0.), peak))) / unit;
+            maxError = std::max(maxError, error);
+            squares += error * error;
+        }
+    }
+
+    const double mse = squares / (static_cast<double>(width) * height);
+    return { maxError, mse > 0 ? 10 * std::log10(range * range / mse) : INFINITY };
+}
+
+static int failures;
+
+static uint64_t readCycles() noexcept {
+#ifdef DCTFILTER_X86
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+// Runs the kernel on frames timed frames of noise, after checking its accuracy on the content frame and the noise. With no timed frames the
+// accuracy is all that is reported, and the energy and block counts of every frame are checked as well.
+static void run(const VSVideoFormat & format, const int width, const int height, const int frames, const int opt, const char * backend, const Kernel & kernel,
+                VSCore * core, const VSAPI * vsapi) {
+    // DCTFilterMulti gets a second clip with other noise, so outputs mixed up between the clips do not go unnoticed.
+    std::vector<VSNode *> sources{ createSource(format, width, height, 1, core, vsapi) };
+    if (kernel.multi)
+        sources.push_back(createSource(format, width, height, 2, core, vsapi));
+
+    const bool measure = !frames && !kernel.coeffs;
+
+    VSMap * in = vsapi->createMap();
+    VSMap * out = vsapi->createMap();
+    for (const auto source : sources)
+        vsapi->mapSetNode(in, kernel.multi ? "clips" : "clip", source, maAppend);
+    vsapi->mapSetFloatArray(in, "factors", kernel.factors.data(), static_cast<int>(kernel.factors.size()));
+    vsapi->mapSetInt(in, "opt", opt, maReplace);
+    vsapi->mapSetInt(in, "fixed", kernel.fixed, maReplace);
+    vsapi->mapSetInt(in, "blocksize", kernel.blocksize, maReplace);
+    vsapi->mapSetInt(in, "overlap", kernel.overlap, maReplace);
+    vsapi->mapSetInt(in, "threads", kernel.threads, maReplace);
+    vsapi->mapSetInt(in, "zigzag", kernel.zigzag, maReplace);
+    vsapi->mapSetInt(in, "inplace", kernel.inplace, maReplace);
+    vsapi->mapSetInt(in, "stats", measure, maReplace);
+    vsapi->mapSetInt(in, "energy", measure, maReplace);
+
+    for (int plane = 0; kernel.planes && plane < format.numPlanes; plane++) {
+        if (kernel.filters(plane))
+            vsapi->mapSetInt(in, "planes", plane, maAppend);
+    }
+
+    if (kernel.radius) {
+        vsapi->mapSetInt(in, "radius", kernel.radius, maReplace);
+        vsapi->mapSetFloatArray(in, "tfactors", kernel.tfactors.data(), static_cast<int>(kernel.tfactors.size()));
+    }
+
+    if (kernel.flat > 0.)
+        vsapi->mapSetFloat(in, "flat", flatThreshold(kernel, format), maReplace);
+    if (kernel.strength)
+        vsapi->mapSetData(in, "strength", "BenchStrength", -1, dtUtf8, maReplace);
+    if (kernel.coeffs)
+        vsapi->mapSetData(in, "output", "coeffs", -1, dtUtf8, maReplace);
+    // The accuracy check has no use for patient plans.
+    if (!frames)
+        vsapi->mapSetData(in, "planner", "estimate", -1, dtUtf8, maReplace);
+
+    std::printf("%2d-bit %-5s %-6s %4dx%-4d  %-7s %-8s ", format.bitsPerSample, format.sampleType == stFloat ? "float" : "int",
+                format.colorFamily == cfYUV ? "YUV420" : "Gray", width, height, backend, kernel.name);
+
+    (kernel.multi ? dctfilterMultiCreate : dctfilterCreate)(in, out, nullptr, core, vsapi);
+
+    VSNode * coeffs = nullptr;
+
+    // The coefficients are turned back into pixels of the source format, which are then checked like the filter's own.
+    if (kernel.coeffs && !vsapi->mapGetError(out)) {
+        coeffs = vsapi->mapGetNode(out, "clip", 0, nullptr);
+        vsapi->clearMap(in);
+        vsapi->clearMap(out);
+        vsapi->mapSetNode(in, "clip", coeffs, maReplace);
+        vsapi->mapSetInt(in, "blocksize", kernel.blocksize, maReplace);
+        vsapi->mapSetInt(in, "width", width, maReplace);
+        vsapi->mapSetInt(in, "height", height, maReplace);
+        vsapi->mapSetInt(in, "format", VS_MAKE_VIDEO_ID(format.colorFamily, format.sampleType, format.bitsPerSample, format.subSamplingW, format.subSamplingH),
+                         maReplace);
+        vsapi->mapSetInt(in, "opt", opt, maReplace);
+        vsapi->mapSetData(in, "planner", "estimate", -1, dtUtf8, maReplace);
+        dctfilterInverseCreate(in, out, nullptr, core, vsapi);
+    }
+
+    vsapi->freeMap(in);
+
+    std::vector<VSNode *> nodes;
+
+    auto release = [&]() {
+        for (const auto node : nodes)
+            vsapi->freeNode(node);
+        for (const auto source : sources)
+            vsapi->freeNode(source);
+        vsapi->freeNode(coeffs);
+    };
+
+    if (vsapi->mapGetError(out)) {
+        std::printf("skipped: %s\n", vsapi->mapGetError(out));
+        vsapi->freeMap(out);
+        release();
+        return;
+    }
+
+    for (size_t i = 0; i < sources.size(); i++)
+        nodes.push_back(vsapi->mapGetNode(out, "clip", static_cast<int>(i), nullptr));
+    vsapi->freeMap(out);
+
+    auto fail = [&](const char * error) {
+        std::printf("failed: %s\n", error);
+        release();
+        failures++;
+    };
+
+    const double peak = format.sampleType == stFloat ? 1. : (1 << format.bitsPerSample) - 1;
+    char error[1024] = {};
+    Accuracy accuracy{ 0, INFINITY }, coefficients{ 0, INFINITY };
+    // Largest change to a plane left alone, largest energy error relative to the plane's total, and whether every block count is right.
+    double changed = 0, energyError = 0;
+    bool counted = true;
+
+    // The first frames also pay for plan creation and page faults in the strip buffers, which leaves them free to check the accuracy on the
+    // content frame and the noise of every output.
+    for (size_t i = 0; i < nodes.size(); i++) {
+        for (int n = 0; n < 2; n++) {
+            const VSFrame * frame = vsapi->getFrame(n, nodes[i], error, sizeof(error));
+            if (!frame)
+                return fail(error);
+
+            const VSFrame * coefficientFrame = coeffs ? vsapi->getFrame(n, coeffs, error, sizeof(error)) : nullptr;
+            if (coeffs && !coefficientFrame) {
+                vsapi->freeFrame(frame);
+                return fail(error);
+            }
+
+            const VSMap * props = vsapi->getFramePropertiesRO(frame);
+
+            for (int plane = 0; plane < format.numPlanes; plane++) {
+                const Reference expected = reference(sources[i], n, plane, kernel, vsapi);
+                const Accuracy result = compare(frame, plane, expected.pixels, 1., peak, vsapi);
+
+                if (kernel.filters(plane))
+                    accuracy = { std::max(accuracy.maxError, result.maxError), std::min(accuracy.psnr, result.psnr) };
+                else
+                    changed = std::max(changed, result.maxError);
+
+                // Coefficients are measured relative to the largest one a block can have.
+                if (coeffs) {
+                    const Accuracy other = compare(coefficientFrame, plane, expected.coefficients, kernel.blocksize * peak, 1., vsapi);
+                    coefficients = { std::max(coefficients.maxError, other.maxError), std::min(coefficients.psnr, other.psnr) };
+                }
+
+                if (measure) {
+                    counted &= vsapi->mapGetInt(props, "_DCTFilterBlocks", plane, nullptr) == expected.blocks;
+
+                    double total = 0;
+                    for (const double band : expected.energy)
+                        total += band;
+
+                    for (int band = 0; band < kernel.blocksize; band++) {
+                        const double other = std::abs(vsapi->mapGetFloat(props, "_DCTFilterEnergy", kernel.blocksize * plane + band, nullptr) -
+                                                      expected.energy[band]);
+                        energyError = std::max(energyError, total > 0 ? other / total : other);
+                    }
+                }
+            }
+
+            vsapi->freeFrame(frame);
+            vsapi->freeFrame(coefficientFrame);
+        }
+    }
+
+    if (frames) {
+        const uint64_t cycles = readCycles();
+        const auto start = std::chrono::steady_clock::now();
+
+        for (int n = 2; n < frames + 2; n++) {
+            const VSFrame * frame = vsapi->getFrame(n, nodes[0], error, sizeof(error));
+            if (!frame)
+                return fail(error);
+
+            vsapi->freeFrame(frame);
+        }
+
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        const double elapsed = static_cast<double>(readCycles() - cycles);
+
+        const double pixels = static_cast<double>(width) * height * frames;
+        const double blocks = static_cast<double>((width + 7) / 8) * ((height + 7) / 8) * frames;
+
+        std::printf("%9.1f Mpix/s %9.2f ns/block", pixels / seconds / 1e6, seconds * 1e9 / blocks);
+        if (elapsed > 0)
+            std::printf(" %9.1f cycles/block", elapsed / blocks);
+    }
+
+    release();
+
+    // Integer results are allowed one step on top of the half step of rounding, and the fixed-point path one more, as it may differ from
+    // the float path by 1. Float results are allowed a little more than a rounding step of their precision, relative to the peak of 1, and
+    // so are the float coefficients, relative to the largest one, and the energy. Planes left alone must come out exactly as they went in.
+    const double tolerance = format.sampleType == stInteger ? (kernel.fixed ? 2. : 1.) : format.bytesPerSample == 2 ? 1e-3 : 1e-5;
+    const bool accurate = accuracy.maxError <= tolerance && coefficients.maxError <= 1e-5 && !changed && energyError <= 1e-5 && counted;
+    failures += !accurate;
+
+    std::printf("  max error %-9.3g PSNR %6.1f dB", accuracy.maxError, accuracy.psnr);
+    if (coeffs)
+        std::printf("  coefficients %-9.3g PSNR %6.1f dB", coefficients.maxError, coefficients.psnr);
+    if (measure)
+        std::printf("  energy %-9.3g blocks %s", energyError, counted ? "right" : "wrong");
+    if (changed)
+        std::printf("  untouched planes changed by %g", changed);
+    std::printf("%s\n", accurate ? "" : "  INACCURATE");
+}
+
+int main(int argc, char **argv) {
+    const bool check = argc > 1 && std::string{ argv[1] } == "check";
+    const int frames = check ? 0 : argc > 1 ? std::max(std::atoi(argv[1]), 1) : 20;
+
+    std::vector<std::pair<int, int>> resolutions{ { 1280, 720 }, { 1920, 1080 }, { 3840, 2160 } };
+    if (check)
+        resolutions = { { 157, 93 } };
+    else if (argc > 3)
+        resolutions = { { std::atoi(argv[2]), std::atoi(argv[3]) } };
+
+    const VSAPI * vsapi = getVapourSynthAPI(VAPOURSYNTH_API_VERSION);
+    if (!vsapi) {
+        std::fprintf(stderr, "Failed to initialize VapourSynth\n");
+        return 1;
+    }
+
+    VSPLUGINAPI pluginAPI{};
+    pluginAPI.configPlugin = configPlugin;
+    pluginAPI.registerFunction = registerFunction;
+    VapourSynthPluginInit2(nullptr, &pluginAPI);
+
+    // The check splits the overlapped frames between several threads, so the rows shared by neighbouring strips are covered too.
+    VSCore * core = vsapi->createCore(0);
+    vsapi->setThreadCount(check ? 4 : 1, core);
+
+    // Separable factors run through the fused operators, a full matrix through the complete transforms, and a matrix which only keeps the
+    // 4x4 lowest frequencies through the pruned kernels.
+    std::vector<double> separable{ 1., 1., 1., 1., 0.8, 0.6, 0.4, 0.2 }, full(64), pruned(64);
+    for (int i = 0; i < 64; i++) {
+        full[i] = 1. / (1. + (i / 8) * (i % 8 + 1) * 0.05);
+        pruned[i] = (i / 8 < 4 && i % 8 < 4) ? full[i] : 0.;
+    }
+
+    std::vector<Kernel> kernels{ { "full", full, false }, { "fused", separable, false }, { "pruned", pruned, false }, { "fixed", separable, true } };
+
+    if (check) {
+        std::vector<double> small{ 1., 0.9, 0.5, 0.2 }, large(16);
+        for (int i = 0; i < 16; i++)
+            large[i] = i < 4 ? 1. : 1. - i * 0.05;
+
+        Kernel kernel{ "4x4", small, false };
+        kernel.blocksize = 4;
+        kernels.push_back(kernel);
+
+        kernel = { "16x16", large, false };
+        kernel.blocksize = 16;
+        kernels.push_back(kernel);
+
+        for (const int overlap : { 2, 4 }) {
+            kernel = { overlap == 2 ? "overlap2" : "overlap4", full, false };
+            kernel.overlap = overlap;
+            kernel.threads = 4;
+            kernels.push_back(kernel);
+        }
+
+        kernel = { "ov4-16", large, false };
+        kernel.blocksize = 16;
+        kernel.overlap = 4;
+        kernel.threads = 4;
+        kernels.push_back(kernel);
+
+        kernel = { "temporal", separable, false };
+        kernel.radius = 1;
+        kernel.tfactors = { 1., 0.5, 0.25 };
+        kernels.push_back(kernel);
+
+        // Only the letterbox blocks are flat, also when overlapped, and keep their ripple.
+        kernel = { "flat", separable, false };
+        kernel.flat = 1.5;
+        kernel.overlap = 2;
+        kernels.push_back(kernel);
+
+        kernel = { "strength", full, false };
+        kernel.strength = true;
+        kernels.push_back(kernel);
+
+        kernel = { "coeffs", full, false };
+        kernel.coeffs = true;
+        kernels.push_back(kernel);
+
+        kernel = { "fix-flat", separable, true };
+        kernel.flat = 1.5;
+        kernels.push_back(kernel);
+
+        kernel = { "zigzag", full, false };
+        kernel.zigzag = true;
+        kernels.push_back(kernel);
+
+        // The middle plane is left alone, next to the threaded split of the others.
+        kernel = { "planes", full, false };
+        kernel.planes = 5;
+        kernel.overlap = 2;
+        kernel.threads = 4;
+        kernels.push_back(kernel);
+
+        kernel = { "inplace", separable, false };
+        kernel.inplace = true;
+        kernel.threads = 4;
+        kernels.push_back(kernel);
+
+        // Both clips share the strip buffers and the seams of the threaded runs.
+        kernel = { "multi", full, false };
+        kernel.multi = true;
+        kernel.overlap = 2;
+        kernel.threads = 4;
+        kernels.push_back(kernel);
+    }
+
+    struct Backend {
+        int opt;
+        const char * name;
+    };
+
+#ifdef DCTFILTER_X86
+    const std::vector<Backend> backends{ { 1, "FFTW" }, { 2, "SSE2" }, { 3, "AVX2" }, { 4, "AVX-512" } };
+#elif defined(DCTFILTER_ARM)
+    const std::vector<Backend> backends{ { 1, "FFTW" }, { 2, "NEON" } };
+#else
+    const std::vector<Backend> backends{ { 1, "FFTW" } };
+#endif
+
+    const int depths[][2] = { { stInteger, 8 }, { stInteger, 10 }, { stInteger, 16 }, { stFloat, 16 }, { stFloat, 32 } };
+
+    // The check also runs on YUV420, whose odd-sized chroma planes get split between the threads too.
+    std::vector<int> families{ cfGray };
+    if (check)
+        families.push_back(cfYUV);
+
+    for (const int family : families) {
+        for (const auto & depth : depths) {
+            VSVideoFormat format;
+            vsapi->queryVideoFormat(&format, family, depth[0], depth[1], family == cfYUV, family == cfYUV, core);
+
+            for (const auto & resolution : resolutions) {
+                for (const auto & backend : backends) {
+                    for (const auto & kernel : kernels) {
+                        // Timing FFTW only makes sense with the complete transforms, and neither it nor the fixed-point path, which only exists
+                        // for 8-10 bit integer input, take flat thresholds. Gray has no planes to leave alone.
+                        if ((backend.opt == 1 && (check ? kernel.fixed || kernel.flat > 0. : kernel.factors != full)) ||
+                            (kernel.fixed && depth[1] > 10) || kernel.planes >> format.numPlanes)
+                            continue;
+
+                        run(format, resolution.first, resolution.second, frames, backend.opt, backend.name, kernel, core, vsapi);
+                    }
+                }
+            }
+        }
+    }
+
+    vsapi->freeCore(core);
+
+    if (failures)
+        std::printf("%d runs failed or lost accuracy\n", failures);
+
+    return failures ? 1 : 0;
+}
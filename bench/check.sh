@@ -0,0 +1,3 @@
+#!/bin/sh
+# Checks every implementation against the double precision reference, without timing them.
+exec ./dctfilter_bench check